@@ -18,9 +18,7 @@
 
 #include "algo_alphabeta.hh"
 #include "ttable.hh"
-#include "threadtunnel.hh"
 #include "util.hh"
-#include "mainapp.hh"
 
 #include <stdlib.h>
 #include <iostream>
@@ -33,25 +31,57 @@
 #define LOGSEARCH false
 #define ALGOTRACE 0
 
-const PlayerIF_AlgoAB::eval_t EVAL_INFTY=10000;
-const PlayerIF_AlgoAB::eval_t EVAL_WIN  = 9000;
+#define SPLIT_MIN_DEPTH     4  // minimum remaining depth of split points
+#define SPLIT_TABLE_SIZE_MB 1  // size of the private transposition table of each thread for split tasks
+#define SPLIT_MERGE_DEPTH   1  // minimum depth of the split-task entries that are stored in the shared table
+#define SPLIT_MERGE_ENTRIES (1<<14) // maximum number of these entries per task
 
+/* Evaluations are integers in units of 1/EVAL_SCALE pieces. Won positions are
+   EVAL_INFTY minus the number of plies until the win, which is above EVAL_WIN.
+   All values fit into the 16 bits of the transposition-table entries. */
+const AlphaBetaSearch::eval_t EVAL_INFTY=30000;
+const AlphaBetaSearch::eval_t EVAL_WIN  =29000;
+const AlphaBetaSearch::eval_t EVAL_NULLWINDOW = 1; // width of null windows (PVS)
 
-inline void addPly(PlayerIF_AlgoAB::eval_t& e)
+// initial half-width of aspiration windows (results of successive iterations often differ by about one piece)
+const AlphaBetaSearch::eval_t ASPIRATION_WINDOW = 2*AlphaBetaSearch::EVAL_SCALE;
+
+// a null-move cut-off is only taken if the verification search beats beta by this margin
+const AlphaBetaSearch::eval_t NULLMOVE_VERIFY_MARGIN = AlphaBetaSearch::EVAL_SCALE;
+#define ASPIRATION_MIN_DEPTH 3
+#define ASPIRATION_MAX_FAILS 3  // search with the full window after this many failed searches
+
+#define NULLMOVE_MIN_DEPTH 3  // minimum remaining depth for trying a null move
+#define NULLMOVE_REDUCTION 2  // depth reduction of the null-move and verification searches
+#define NULLMOVE_MIN_MOBILITY 6 // no null move if the side to move has fewer moves (zugzwang)
+#define LMR_MIN_DEPTH      3  // minimum remaining depth for late-move reductions
+#define LMR_MIN_MOVES      3  // number of moves searched with full depth before reducing
+#define SYMMETRY_MAX_DIFF  4  // maximum number of differing positions of a nearly symmetric start board
+
+
+inline void addPly(AlphaBetaSearch::eval_t& e)
 {
   /**/ if (e> EVAL_WIN) e--;
   else if (e<-EVAL_WIN) e++;
 }
 
-inline void subPly(PlayerIF_AlgoAB::eval_t& e)
+inline void subPly(AlphaBetaSearch::eval_t& e)
 {
   /**/ if (e> EVAL_WIN) e++;
   else if (e<-EVAL_WIN) e--;
 }
 
-int nPlysUntilEnd(PlayerIF_AlgoAB::eval_t e)
+// evaluation of an endgame-database value from the view of the player to move
+static AlphaBetaSearch::eval_t egdbEval(EGDBValue v)
+{
+  /**/ if (egdbIsWin (v)) return   EVAL_INFTY-egdbPlies(v);
+  else if (egdbIsLoss(v)) return -(EVAL_INFTY-egdbPlies(v));
+  else                    return 0;
+}
+
+int nPlysUntilEnd(AlphaBetaSearch::eval_t e)
 {
-  e=fabs(e);
+  e=abs(e);
   return EVAL_INFTY-e;
 }
 
@@ -67,23 +97,45 @@ static int timeDiff_ms(const struct timeval& t1,
 }
 
 
-PlayerIF_AlgoAB::PlayerIF_AlgoAB()
-  : m_tunnel(NULL),
-    thread(NULL)
+AlphaBetaSearch::AlphaBetaSearch()
+  : m_observer(NULL),
+    m_stopRequest(0),
+    m_limitReached(false)
 {
   moveCnt=0;
 
-  m_maxMSecs = 1000;
-  m_maxDepth = 25;
+  m_nThreads = 1;
+  m_parallelMode = Parallel_SharedTT;
+  m_usePVS = true;
+  m_useAspiration = true;
+  m_useQuiescence = true;
+  m_useNullMove = false;
+  m_useLMR = false;
+  m_useSymmetricHashing = true;
+  m_searchSymmetric = false;
+
+  m_mainThread.algo = this;
+  m_stopHelpers = false;
+  m_nextSplitID = 0;
+
+  g_mutex_init(&m_poolMutex);
+  g_cond_init(&m_poolCond);
+
+  setEvalWeight(Weight_Material,   1.0);
+  setEvalWeight(Weight_Freedom,    0.2);
+  setEvalWeight(Weight_Mills,      0.8);
+  setEvalWeight(Weight_Experience, 1.0);
+}
+
 
-  m_weight[Weight_Material] = 1.0;
-  m_weight[Weight_Freedom]  = 0.2;
-  m_weight[Weight_Mills]    = 0.8;
-  m_weight[Weight_Experience] = 1.0;
+AlphaBetaSearch::~AlphaBetaSearch()
+{
+  g_mutex_clear(&m_poolMutex);
+  g_cond_clear(&m_poolCond);
 }
 
 
-void PlayerIF_AlgoAB::resetGame()
+void AlphaBetaSearch::resetGame()
 {
  /* We have to clear the t-table to prevent that
     the computer always plays the same game. */
@@ -92,62 +144,139 @@ void PlayerIF_AlgoAB::resetGame()
 }
 
 
-void startSearchThread(class PlayerIF_AlgoAB*);
-
-void PlayerIF_AlgoAB::startMove(const Board& curr, int moveID)
+/* Symmetric boards can only both occur in the search tree if the start board is (nearly)
+   symmetric itself. Otherwise, maintaining the symmetric hashes costs more than we gain. */
+static bool nearlySymmetric(const Board& b, const BoardSpec& spec)
 {
-  /*
-  std::cout << "-------------------- ";
-  if (curr.getCurrentPlayer()==PL_White) std::cout << "white";
-  else std::cout << "black";
-  std::cout << " (ply=" << curr.getPly() << ")\n";
-  */
+  const PositionMask white = b.getPieces(PL_White);
+  const PositionMask black = b.getPieces(PL_Black);
+
+  for (int i=1;i<spec.getPermutations().size();i++) // skip the identity
+    {
+      const int diff = (nPositionsInMask(spec.permuteMask(i,white) ^ white) +
+			nPositionsInMask(spec.permuteMask(i,black) ^ black));
 
+      if (diff <= SYMMETRY_MAX_DIFF)
+	return true;
+    }
+
+  return false;
+}
+
+AlphaBetaSearch::SearchResult AlphaBetaSearch::search(const Board& curr, const RepetitionStack& history,
+							const SearchLimits& limits)
+{
   moveCnt++;
 
-  m_stopThread=false;
-  m_ignoreMove=false;
   m_computedSomeMove=false;
+  m_limitReached=false;
+  m_limits = limits;
 
   m_startBoard = curr;
-  m_moveID = moveID;
-
-  thread = g_thread_new(NULL, (GThreadFunc)startSearchThread,  this);
-}
-
+  m_startBoard.attachBoardSpec(m_ruleSpec->boardSpec.get());
+  m_searchSymmetric = (m_useSymmetricHashing &&
+		       nearlySymmetric(m_startBoard, *m_ruleSpec->boardSpec));
 
-// kicker
-void startSearchThread(class PlayerIF_AlgoAB* algo)
-{
-  algo->doSearch();
-}
+  // an intermediate board of a partial move is not in the history and cannot be a repetition
+  m_startHistory = history;
+  if (m_startHistory.empty() || m_startHistory.top() != m_startBoard.getHash())
+    { m_startHistory.push(m_startBoard, true); }
 
+  if (m_egdb && m_egdb->matchesRules(*m_ruleSpec)) m_searchEGDB = m_egdb;
+  else m_searchEGDB.reset();
 
-void PlayerIF_AlgoAB::doSearch()
-{
   gettimeofday(&m_startTime,NULL);
 
   m_move.reset();
   m_ttable->resetStats();
+  m_ttable->newSearch();
+  m_mainThread.moveStack.clear();
+  m_mainThread.history.clear();
+  m_mainThread.repetitions = m_startHistory;
+  m_mainThread.splitPathID = -1;
+  m_mainThread.clearSymmetricHashes();
+  m_mainThread.nodesSearched = 0;
 
-  float e;
+  startHelperThreads();
 
-  for (int depth=1; depth<=m_maxDepth;depth++)
+  SearchResult result;
+  result.eval  = 0;
+  result.depth = 0;
+
+  eval_t e;
+  eval_t prevEval=0; // result of the previous iteration, not normalized
+
+  // if the start position is in the database, all moves lead to positions with exact values
+  EGDBValue rootValue;
+  const bool rootInEGDB = (m_searchEGDB && egdbCovers(m_startBoard) &&
+			   m_searchEGDB->probe(m_startBoard, rootValue));
+
+  for (int depth=1; depth<=m_limits.maxDepth;depth++)
     {
-      m_nodesEvaluated=0;
+      m_mainThread.nodesEvaluated=0;
+      m_mainThread.nodesQuiescence=0;
+      m_mainThread.nodesEGDB=0;
 
       Variation var;
-      e = NegaMax(m_startBoard, -EVAL_INFTY, EVAL_INFTY, 0, depth, var, true);
+
+      if (m_useAspiration && depth>=ASPIRATION_MIN_DEPTH && abs(prevEval) < EVAL_WIN)
+	{
+	  // search with a window around the previous result, widen it until the result is inside
+
+	  eval_t window = ASPIRATION_WINDOW;
+
+	  for (int nFails=0 ;; nFails++)
+	    {
+	      eval_t alpha = prevEval-window;
+	      eval_t beta  = prevEval+window;
+
+	      const bool fullWindow = (nFails == ASPIRATION_MAX_FAILS);
+	      if (fullWindow) { alpha=-EVAL_INFTY; beta=EVAL_INFTY; }
+
+	      var.clear();
+	      e = NegaMax(m_mainThread, m_startBoard, alpha, beta, 0, depth, var, true);
+
+	      if (fullWindow || (e>alpha && e<beta) || aborted(m_mainThread))
+		break;
+
+	      window *= 4;
+	    }
+	}
+      else
+	{
+	  e = NegaMax(m_mainThread, m_startBoard, -EVAL_INFTY, EVAL_INFTY, 0, depth, var, true);
+	}
+
+      // the iteration is incomplete, only its best move so far (in m_move) is used
+
+      if (aborted(m_mainThread))
+	break;
+
+      prevEval = e;
+
+      // the variation is empty if the result was taken from the transposition table
+      if (var.size()==0 && m_computedSomeMove) { var = variationFromTable(m_startBoard, m_move, depth); }
+
+      sendSearchInfo(var, e, depth);
+
+      result.eval  = e;
+      result.depth = depth;
+      result.pv    = var;
 
       // normalize evaluation for white
       if (m_startBoard.getCurrentPlayer()==PL_Black) { e = -e; }
 
       if (LOGSEARCH)
 	std::cout << "STEP move " << m_move << " depth " << depth << " -> eval=" << e
-		  << " nodes evaluated= " << m_nodesEvaluated
+		  << " nodes evaluated= " << m_mainThread.nodesEvaluated
+		  << " quiescence nodes= " << m_mainThread.nodesQuiescence
+		  << " database nodes= " << m_mainThread.nodesEGDB
 		  << "\n";
 
-      if (fabs(e) >= EVAL_WIN)
+      if (rootInEGDB)
+	break;
+
+      if (abs(e) >= EVAL_WIN)
 	{
 	  int overInPlys = nPlysUntilEnd(e);
 
@@ -159,52 +288,344 @@ void PlayerIF_AlgoAB::doSearch()
 	}
     }
 
-  m_tunnel->doMove(m_move, m_moveID);
-  installJoinThreadHandler();
+  stopHelperThreads();
+
+  struct timeval endTime;
+  gettimeofday(&endTime,NULL);
+
+  result.move  = m_move;
+  result.nodes = nodesSearched();
+  result.msecs = timeDiff_ms(m_startTime, endTime);
+
+  // the stopped iteration may have found a better move than the last complete one
+  if (result.pv.size()==0 || !(result.pv[0] == m_move))
+    {
+      result.pv.clear();
+      if (m_computedSomeMove) { result.pv.push_back(m_move); }
+    }
+
+  return result;
 }
 
 
-void PlayerIF_AlgoAB::installJoinThreadHandler()
+void AlphaBetaSearch::stop()
 {
-  class IdleFunc_JoinAlgoThread : public IdleFunc
-  {
-  public:
-    IdleFunc_JoinAlgoThread(PlayerIF_AlgoAB* algo) : obj(algo) { }
+  g_atomic_int_set(&m_stopRequest, 1);
+}
 
-    void operator()() { obj->joinThread(); }
 
-  private:
-    PlayerIF_AlgoAB* obj;
-  };
+void AlphaBetaSearch::clearStop()
+{
+  g_atomic_int_set(&m_stopRequest, 0);
+}
+
 
-  IdleFunc::install(new IdleFunc_JoinAlgoThread(this));
+// kicker
+void startHelperThread(AlphaBetaSearch::SearchThread* t)
+{
+  if (t->algo->m_parallelMode == AlphaBetaSearch::Parallel_SplitPoints)
+    { t->algo->doWorkerLoop(*t); }
+  else
+    { t->algo->doHelperSearch(*t); }
 }
 
 
-void PlayerIF_AlgoAB::forceMove()
+void AlphaBetaSearch::startHelperThreads()
 {
-  m_stopThread=true;
+  m_stopHelpers = false;
+
+  while ((int)m_helperThreads.size() < m_nThreads-1)
+    {
+      boost::shared_ptr<SearchThread> t(new SearchThread);
+      t->algo = this;
+      t->id   = m_helperThreads.size()+1;
+      m_helperThreads.push_back(t);
+    }
+
+  m_helperThreads.resize(m_nThreads-1);
+
+  for (size_t i=0;i<m_helperThreads.size();i++)
+    {
+      SearchThread* t = m_helperThreads[i].get();
+      t->thread = g_thread_new(NULL, (GThreadFunc)startHelperThread, t);
+    }
 }
 
-void PlayerIF_AlgoAB::cancelMove()
+
+void AlphaBetaSearch::stopHelperThreads()
 {
-  m_ignoreMove=true;
-  m_stopThread=true;
+  g_mutex_lock(&m_poolMutex);
+  m_stopHelpers = true;
+  g_cond_broadcast(&m_poolCond); // wake up waiting workers
+  g_mutex_unlock(&m_poolMutex);
 
-  joinThread();
+  for (size_t i=0;i<m_helperThreads.size();i++)
+    {
+      SearchThread* t = m_helperThreads[i].get();
+      if (t->thread)
+	{
+	  g_thread_join(t->thread);
+	  t->thread=NULL;
+	}
+    }
+
+  // tasks of an aborted search may still be queued
+  m_taskQueue.clear();
+}
+
+
+long AlphaBetaSearch::nodesSearched() const
+{
+  long n = m_mainThread.nodesSearched;
+
+  // the counters of the helper threads are read while they are running, this is only for display
+  for (size_t i=0;i<m_helperThreads.size();i++)
+    n += m_helperThreads[i]->nodesSearched;
+
+  return n;
 }
 
-void PlayerIF_AlgoAB::joinThread()
+
+/* The helper threads run the same iterative deepening as the main thread, but each
+   helper searches the root moves in its own random order, and every second helper
+   is one ply ahead. Their results reach the main thread only through the shared
+   transposition table, where they improve the move ordering and cut off parts of
+   the main search. The helpers run until the main thread stops them.
+ */
+void AlphaBetaSearch::doHelperSearch(SearchThread& t)
 {
-  if (thread)
+  t.moveStack.clear();
+  t.history.clear();
+  t.repetitions = m_startHistory;
+  t.clearSymmetricHashes();
+  t.nodesSearched = 0;
+
+  for (int depth=1+(t.id&1); depth<=m_limits.maxDepth && !m_stopHelpers; depth++)
     {
-      g_thread_join(thread);
-      thread=NULL;
+      t.nodesEvaluated=0;
+
+      Variation var;
+      NegaMax(t, m_startBoard, -EVAL_INFTY, EVAL_INFTY, 0, depth, var, true);
     }
 }
 
 
-inline void PlayerIF_AlgoAB::checkTime()
+// worker threads of Parallel_SplitPoints mode run the queued tasks until they are stopped
+void AlphaBetaSearch::doWorkerLoop(SearchThread& t)
+{
+  t.moveStack.clear();
+  t.splitPathID = -1;
+  t.clearSymmetricHashes();
+  t.nodesSearched = 0;
+
+  g_mutex_lock(&m_poolMutex);
+
+  while (!m_stopHelpers)
+    {
+      if (m_taskQueue.empty())
+	{
+	  g_cond_wait(&m_poolCond, &m_poolMutex);
+	}
+      else
+	{
+	  SplitTask* task = m_taskQueue.front();
+	  m_taskQueue.pop_front();
+
+	  g_mutex_unlock(&m_poolMutex);
+	  runSplitTask(t, *task);
+	  g_mutex_lock(&m_poolMutex);
+	}
+    }
+
+  g_mutex_unlock(&m_poolMutex);
+}
+
+
+/* Only the main thread splits, and not within split tasks. Hence, the split points are on
+   the leftmost path of the tree (where the search effort is largest), there is only one
+   active split point at a time, and the shared transposition table is not written while
+   the split tasks are searched.
+ */
+bool AlphaBetaSearch::canSplit(const SearchThread& thread, int levels_to_go) const
+{
+  return (m_parallelMode == Parallel_SplitPoints &&
+	  !m_helperThreads.empty() &&
+	  thread.task == NULL &&
+	  levels_to_go >= SPLIT_MIN_DEPTH);
+}
+
+
+/* Queue all tasks of the split point and wait until they are finished. While waiting,
+   this thread helps with running queued tasks (of any split point).
+ */
+void AlphaBetaSearch::searchSplitPoint(SearchThread& thread, SplitPoint& split)
+{
+  g_mutex_lock(&m_poolMutex);
+
+  split.nPending = split.tasks.size();
+  split.cutoff   = split.tasks.size();
+
+  for (size_t i=0;i<split.tasks.size();i++)
+    m_taskQueue.push_back(&split.tasks[i]);
+
+  g_cond_broadcast(&m_poolCond);
+
+  while (split.nPending>0)
+    {
+      if (!m_taskQueue.empty())
+	{
+	  SplitTask* task = m_taskQueue.front();
+	  m_taskQueue.pop_front();
+
+	  g_mutex_unlock(&m_poolMutex);
+	  runSplitTask(thread, *task);
+	  g_mutex_lock(&m_poolMutex);
+	}
+      else
+	{
+	  // wake up regularly, such that the main thread can check the thinking time
+
+	  g_cond_wait_until(&m_poolCond, &m_poolMutex, g_get_monotonic_time() + 10*G_TIME_SPAN_MILLISECOND);
+
+	  if (thread.isMainThread())
+	    {
+	      g_mutex_unlock(&m_poolMutex);
+	      checkTime();
+	      g_mutex_lock(&m_poolMutex);
+	    }
+	}
+    }
+
+  g_mutex_unlock(&m_poolMutex);
+
+  // the tasks that were run by this thread have replaced its killers and history
+  thread.history = split.history;
+}
+
+
+void AlphaBetaSearch::runSplitTask(SearchThread& thread, SplitTask& task)
+{
+  SplitPoint& split = *task.split;
+
+  /* Moves after a beta cut-off need not be searched, since their results will not be used.
+     As we only skip moves after the first cut-off found so far, this does not change the result. */
+
+  g_mutex_lock(&m_poolMutex);
+  const bool skip = (task.index > split.cutoff);
+  g_mutex_unlock(&m_poolMutex);
+
+  if (!skip)
+    {
+      Board board = *split.board;
+      board.doMove(task.move);
+
+      /* Continue the search path of the split point. As there is only one active split point,
+	 each thread only copies the path for its first task of a split point. The splitting
+	 thread is on this path already. */
+
+      if (thread.splitPathID != split.id)
+	{
+	  thread.repetitions = *split.repetitions;
+	  thread.splitPathID = split.id;
+	}
+
+      thread.repetitions.push(board);
+
+      // every task starts in the same state, independent of the thread that runs it
+
+      if (thread.privateTable) { thread.privateTable->clear(); }
+      else { thread.privateTable = ttable_ptr(new TranspositionTable(SPLIT_TABLE_SIZE_MB)); }
+
+      thread.history = split.history;
+      thread.task    = &task;
+
+      eval_t eval = searchMove(thread, board, split.alpha, split.beta, split.currDepth, split.levels_to_go,
+			       task.variation, true, false);
+
+      thread.task = NULL;
+      thread.repetitions.pop();
+
+      if (split.currDepth==0) { addExperience(eval, board); }
+
+      task.eval = eval;
+    }
+
+  g_mutex_lock(&m_poolMutex);
+
+  if (!skip && task.eval >= split.beta && task.index < split.cutoff)
+    { split.cutoff = task.index; }
+
+  split.nPending--;
+  g_cond_broadcast(&m_poolCond);
+
+  g_mutex_unlock(&m_poolMutex);
+}
+
+
+/* Store the deep table entries of the tasks whose results are used, in move order, such that
+   the shared table is the same for every scheduling. With SAFE_HASH, the entries cannot be
+   stored, because their boards are unknown.
+ */
+void AlphaBetaSearch::mergeSplitTables(const SplitPoint& split)
+{
+  if (SAFE_HASH) { return; }
+
+  for (int i=0; i<(int)split.tasks.size() && i<=split.cutoff; i++)
+    {
+      const std::vector<SplitTableEntry>& entries = split.tasks[i].tableEntries;
+
+      for (size_t k=0;k<entries.size();k++)
+	{
+	  const SplitTableEntry& e = entries[k];
+	  m_ttable->insert(e.hash, e.eval, TranspositionTable::BoundType(e.bound), e.depth,
+			   e.bestMove.unpack(), *split.board);
+	}
+    }
+}
+
+
+bool AlphaBetaSearch::lookupTable(const SearchThread& thread, BoardHash hash,
+				  TranspositionTable::Entry& entry, const Board& board) const
+{
+  if (thread.task && thread.privateTable->lookup(hash, entry, board)) { return true; }
+
+  return m_ttable->lookup(hash, entry, board);
+}
+
+
+void AlphaBetaSearch::storeInTable(SearchThread& thread, BoardHash hash, eval_t eval,
+				   TranspositionTable::BoundType bound, int depth,
+				   const Move& bestMove, const Board& board)
+{
+  if (thread.task==NULL)
+    {
+      m_ttable->insert(hash, eval, bound, depth, bestMove, board);
+      return;
+    }
+
+  thread.privateTable->insert(hash, eval, bound, depth, bestMove, board);
+
+  /* The deep entries are stored last (when their subtrees are finished). Half of the
+     space is kept free for them. */
+
+  std::vector<SplitTableEntry>& entries = thread.task->tableEntries;
+
+  if (depth >= SPLIT_MERGE_DEPTH &&
+      entries.size() < (depth > SPLIT_MERGE_DEPTH ? SPLIT_MERGE_ENTRIES : SPLIT_MERGE_ENTRIES/2))
+    {
+      SplitTableEntry e;
+      e.hash     = hash;
+      e.eval     = eval;
+      e.depth    = depth;
+      e.bound    = bound;
+      e.bestMove = PackedMove(bestMove);
+
+      entries.push_back(e);
+    }
+}
+
+
+inline void AlphaBetaSearch::checkTime()
 {
   struct timeval endTime;
   gettimeofday(&endTime,NULL);
@@ -212,17 +633,20 @@ inline void PlayerIF_AlgoAB::checkTime()
   int timeDiffMS = timeDiff_ms(m_startTime, endTime);
 
   // thinking time is over
-  if (timeDiffMS >= m_maxMSecs)
+  if (timeDiffMS >= m_limits.maxMSecs)
     {
-      m_stopThread = true;
+      m_limitReached = true;
     }
 
   // update progress bar
-  float perc = timeDiffMS;
-  perc /= m_maxMSecs;
-  if (perc>1.0) perc=1.0;
+  if (m_observer)
+    {
+      float perc = timeDiffMS;
+      perc /= m_limits.maxMSecs;
+      if (perc>1.0) perc=1.0;
 
-  m_tunnel->setProgress(perc);
+      m_observer->setProgress(perc);
+    }
 }
 
 
@@ -231,39 +655,78 @@ inline void PlayerIF_AlgoAB::checkTime()
 #define INDENT std::cout << "-" << (&"| | | | | | | | | | "[20-currDepth*2]);
 
 
-float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
-			       int currDepth, int levels_to_go, Variation& variation, bool useTT)
+AlphaBetaSearch::eval_t AlphaBetaSearch::NegaMax(SearchThread& thread, const Board& board,
+						 eval_t alpha, eval_t beta,
+						 int currDepth, int levels_to_go, Variation& variation, bool useTT,
+						 bool allowNullMove)
 {
   if (ALGOTRACE) { INDENT; std::cout << "--- NEGAMAX (" << alpha << ";" << beta << ") ---\n"; }
 
 
   const bool atRoot = (currDepth==0);
+  const bool isMain = thread.isMainThread();
+
+  if (aborted(thread)) { return 0; }
 
   // check thinking time and stop if we were thinking too long
 
-  if (levels_to_go>5 || atRoot)
+  if (isMain && (levels_to_go>5 || atRoot))
     {
-      if (useTT) checkTime();
+      checkTime();
     }
 
-  if (m_stopThread && m_computedSomeMove)
+  thread.nodesSearched++;
+
+  if (isMain && m_limits.maxNodes>0 && thread.nodesSearched >= m_limits.maxNodes)
     {
-      if (!m_ignoreMove) { m_tunnel->doMove(m_move, m_moveID); }
-      installJoinThreadHandler();
-      g_thread_exit(NULL);
+      m_limitReached = true;
     }
 
+  if (isMain && aborted(thread)) { return 0; }
+
   // check winning situations
 
   if (board.getNPiecesLeft( board.getCurrentPlayer() )<3) { return -EVAL_INFTY; }
 
+  if (!atRoot && isRepetitionDraw(thread))
+    {
+      if (ALGOTRACE) { INDENT; std::cout << "repetition\n"; }
+      return 0;
+    }
+
+  /* Positions of the movement phase in a solved subspace have an exact value.
+     At the root, we still have to search to find the move. */
+
+  EGDBValue dbValue;
+  if (m_searchEGDB && !atRoot && egdbCovers(board) &&
+      m_searchEGDB->probe(board, dbValue))
+    {
+      thread.nodesEGDB++;
+
+      if (ALGOTRACE) { INDENT; std::cout << "endgame database: " << int(dbValue) << "\n"; }
+      return egdbEval(dbValue);
+    }
 
   // check transposition-table
 
-  const float oldAlpha = alpha;
+  const eval_t oldAlpha = alpha;
+
+  int symmetry=-1;
+  const BoardHash hash = (useTT ? tableHash(board, thread.symHashes[std::min(currDepth, MAXSEARCHDEPTH-1)],
+					    symmetry) : 0);
 
+  TranspositionTable::Entry ttEntry;
   const TranspositionTable::Entry* entry = NULL;
-  if (useTT) entry = m_ttable->lookup(board.getHash(), board);
+  if (useTT && lookupTable(thread, hash, ttEntry, board)) entry = &ttEntry;
+  if (entry && symmetry>=0) { ttEntry.bestMove = PackedMove(fromTable(ttEntry.bestMove.unpack(), symmetry)); }
+
+  /* The move of a root entry is played without a search. As the table is shared between
+     threads and positions, a key collision or a torn entry could give any move, hence
+     the entry is only used if its move is legal. */
+
+  if (entry && atRoot && !m_ruleSpec->isValidCompleteMove(board, entry->bestMove.unpack()))
+    { entry = NULL; }
+
   if (entry)
     {
       if (entry->depth >= levels_to_go)
@@ -272,9 +735,9 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 
 	  if (entry->getBoundType() == TranspositionTable::AccurateValue)
 	    {
-	      if (atRoot)
+	      if (atRoot && isMain)
 		{
-		  m_move = entry->bestMove;
+		  m_move = entry->bestMove.unpack();
 		  m_computedSomeMove=true;
 		  logBestMoveFromTable(board, m_move, entry->eval, entry->depth);
 		}
@@ -284,18 +747,18 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 	    }
 	  else if (entry->getBoundType() == TranspositionTable::LowerBound)
 	    {
-	      alpha = std::max(alpha, entry->eval);
+	      alpha = std::max(alpha, eval_t(entry->eval));
 	    }
 	  else if (entry->getBoundType() == TranspositionTable::UpperBound)
 	    {
-	      beta = std::min(beta, entry->eval);
+	      beta = std::min(beta, eval_t(entry->eval));
 	    }
 
 	  if (alpha >= beta)
 	    {
-	      if (atRoot)
+	      if (atRoot && isMain)
 		{
-		  m_move = entry->bestMove;
+		  m_move = entry->bestMove.unpack();
 		  m_computedSomeMove=true;
 		}
 
@@ -310,7 +773,11 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 
   if (levels_to_go==0)
     {
-      float eval = Eval(board, levels_to_go);
+      thread.nodesEvaluated++;
+
+      eval_t eval;
+      if (m_useQuiescence) { eval = Quiescence(thread, board, alpha, beta, currDepth); }
+      else                 { eval = Eval(board, levels_to_go); }
 
       /*
       float memeval = -m_posMemory.lookupHash(board);
@@ -325,10 +792,59 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
       return eval;
     }
 
-  // try previous best-move first
+  /* Null move (movement phase only): let the opponent move twice with reduced depth.
+     If we still fail high, the cut-off is only taken if a reduced-depth search of our
+     real moves confirms it with a margin, since passing may be better than every move
+     in zugzwang. There are no two null moves in a row, and no null move in the
+     verification search of this node itself. Neither is there a null move when a won
+     or lost game is in sight, because the reduced searches would hide the distance
+     to the end of the game. */
+
+  if (m_useNullMove && allowNullMove && !atRoot &&
+      levels_to_go >= NULLMOVE_MIN_DEPTH &&
+      board.getNPiecesToSet()==0 &&
+      abs(alpha) < EVAL_WIN && abs(beta) < EVAL_WIN &&
+      !(entry && abs(entry->eval) >= EVAL_WIN) &&
+      Eval(board, levels_to_go) >= beta &&
+      nullMoveIsSafe(thread, board))
+    {
+      Board nullBoard = board;
+      nullBoard.togglePlayer();
+      thread.repetitions.push(nullBoard, true);
+
+      Variation nullVar;
+      eval_t recBeta  = beta;                 subPly(recBeta);
+      eval_t recAlpha = beta-EVAL_NULLWINDOW; subPly(recAlpha);
+      eval_t nullEval = -NegaMax(thread, nullBoard, -recBeta, -recAlpha, currDepth+1,
+				 levels_to_go-1-NULLMOVE_REDUCTION, nullVar, useTT, false);
+      addPly(nullEval);
+
+      thread.repetitions.pop();
+
+      if (aborted(thread)) { return 0; }
+
+      if (nullEval >= beta)
+	{
+	  const eval_t verifyBeta = beta + NULLMOVE_VERIFY_MARGIN;
+
+	  Variation verifyVar;
+	  eval_t verifyEval = NegaMax(thread, board, verifyBeta-EVAL_NULLWINDOW, verifyBeta, currDepth,
+				      levels_to_go-NULLMOVE_REDUCTION, verifyVar, useTT, false);
+
+	  if (aborted(thread)) { return 0; }
+
+	  if (verifyEval >= verifyBeta)
+	    {
+	      if (ALGOTRACE) { INDENT; std::cout << "null-move cut-off\n"; }
+
+	      variation = verifyVar;
+	      return verifyEval;
+	    }
+	}
+    }
 
   Board tmpBoard;
-  float bestEval = -EVAL_INFTY;
+  eval_t bestEval = -EVAL_INFTY;
   Move  bestMove;
 
   tmpBoard = board;
@@ -336,96 +852,112 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 
   // recurse
 
-  std::vector<Move> moves;
-  moves.reserve(100); // speed-up move generation
-  m_ruleSpec->generateMoves(moves, board);
-
-  if (moves.size()==0)
-    { return -EVAL_INFTY; }
+  /* Move ordering: try previous best-move first, then mill-closing moves, then killer moves,
+     then all others ordered by their history. The moves are generated lazily, since we often
+     get a cut-off after the first moves. */
 
-  // Move ordering: put most promising move to front
+  StagedMoveGenerator moves(*m_ruleSpec, board, thread.moveStack, entry ? entry->bestMove : PackedMove(),
+			    useTT ? &thread.history : NULL, currDepth);
 
-  if (entry)
+  // random move order to randomize play
+  if (RANDOMIZE && atRoot)
     {
-      for (int i=1;i<moves.size();i++)
-	if (moves[i]==entry->bestMove)
-	  {
-	    std::swap(moves[0], moves[i]);
-	    break;
-	  }
+      moves.randomizeOrder();
     }
 
-  // random move order to randomize play
-  if (RANDOMIZE && atRoot)
+  int  nMoves=0;
+  Move move;
+
+  SplitPoint split;
+  bool       isSplit=false;
+  size_t     nextSplitResult=0;
+
+  for (;;)
     {
-      for (int i=1;i<moves.size();i++)
+      eval_t    eval;
+      Variation childVar;
+
+      if (isSplit)
 	{
-	  int idx2 = (rand() % (moves.size()-i)) +i;
+	  // take the next result of the moves that were searched in parallel
 
-	  std::swap(moves[i], moves[idx2]);
-	}
-    }
+	  if (nextSplitResult == split.tasks.size() || (int)nextSplitResult > split.cutoff)
+	    break;
 
-  if (ALGOTRACE)
-    { INDENT; std::cout << "list of moves: ";
-      for (size_t i=0; i<moves.size(); i++)
-	{
-	  std::cout << moves[i] << " ";
+	  const SplitTask& task = split.tasks[nextSplitResult++];
+	  move     = task.move;
+	  eval     = task.eval;
+	  childVar = task.variation;
 	}
-      std::cout << "\n";
-    }
+      else
+	{
+	  if (!moves.next(move))
+	    break;
 
-  for (size_t i=0; i<moves.size(); i++)
-    {
-      if (ALGOTRACE) { INDENT; std::cout << "try move: " << moves[i] << "  (" << alpha << "," << beta << ")\n"; }
+	  if (ALGOTRACE) { INDENT; std::cout << "try move: " << move << "  (" << alpha << "," << beta << ")\n"; }
 
-      tmpBoard.doMove(moves[i]);
+	  tmpBoard.doMove(move);
+	  thread.repetitions.push(tmpBoard);
 
-      Variation childVar;
-      eval_t recBeta  = beta;  subPly(recBeta);
-      eval_t recAlpha = alpha; subPly(recAlpha);
-      float eval = -NegaMax(tmpBoard, -recBeta, -recAlpha, currDepth+1, levels_to_go-1, childVar, useTT);
-      addPly(eval);
+	  // late-move reduction for quiet moves at the end of the move list
 
-      if (currDepth==0 && m_experience!=NULL)
-	{
-	  if (fabs(eval) < EVAL_WIN)
+	  int reduction=0;
+	  if (m_useLMR && !atRoot &&
+	      nMoves >= LMR_MIN_MOVES &&
+	      levels_to_go >= LMR_MIN_DEPTH &&
+	      board.getNPiecesToSet()==0 &&
+	      moves.isQuietMove())
 	    {
-	      float offset = m_experience->getOffset( m_ruleSpec->getBoardID_Symmetric(tmpBoard), m_selfPlayer );
-	      offset *= m_weight[Weight_Experience];
-	      eval += offset;
+	      reduction=1;
 	    }
-	}
 
-      /*
-      if (abs(eval)>EVAL_WIN)
-	m_posMemory.storeBoard(tmpBoard,eval);
-      */
+	  eval = searchMove(thread, tmpBoard, alpha, beta, currDepth, levels_to_go, childVar, useTT, nMoves==0,
+			    reduction);
+
+	  thread.repetitions.pop();
+
+	  if (aborted(thread)) { return 0; }
 
-      tmpBoard.undoMove(moves[i]);
+	  if (atRoot) { addExperience(eval, tmpBoard); }
+
+	  /*
+	  if (abs(eval)>EVAL_WIN)
+	    m_posMemory.storeBoard(tmpBoard,eval);
+	  */
+
+	  tmpBoard.undoMove(move);
+	}
+
+      nMoves++;
 
       if (eval>bestEval)
 	{
 	  bestEval=eval;
-	  bestMove=moves[i];
+	  bestMove=move;
 
 	  variation.clear();
-	  variation.push_back(moves[i]);
+	  variation.push_back(move);
 	  variation.append(childVar);
 
-	  if (atRoot)
+	  // at the root, only take moves that are known to be better than the window start
+
+	  if (atRoot && isMain && bestEval > oldAlpha)
 	    {
 	      logBestMove(variation, bestEval, levels_to_go);
 	      m_move=bestMove;
 	      m_computedSomeMove=true;
 	    }
 
-	  if (ALGOTRACE) { INDENT; std::cout << "set best move to " << moves[i] << " @eval=" << eval << "\n"; }
+	  if (ALGOTRACE) { INDENT; std::cout << "set best move to " << move << " @eval=" << eval << "\n"; }
 
 	  // alpha-beta pruning
 	  if (bestEval>=beta)
 	    {
 	      if (ALGOTRACE) { INDENT; std::cout << "beta cut-off\n"; }
+
+	      if (useTT && move.takes.size()==0)
+		{ thread.history.addCutoff(move, currDepth, levels_to_go); }
+
 	      break;
 	    }
 	}
@@ -436,11 +968,52 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 	  alpha = bestEval;
 	  if (ALGOTRACE) { INDENT; std::cout << "adjust alpha to " << alpha << "\n"; }
 	}
+
+      /* Young brothers wait: after the first move has been searched, all remaining
+	 moves are searched in parallel with the window we have now. */
+
+      if (nMoves==1 && canSplit(thread, levels_to_go))
+	{
+	  split.id           = m_nextSplitID++;
+	  split.board        = &board;
+	  split.repetitions.reset(new RepetitionStack(thread.repetitions));
+	  split.history      = thread.history;
+	  split.alpha        = alpha;
+	  split.beta         = beta;
+	  split.currDepth    = currDepth;
+	  split.levels_to_go = levels_to_go;
+
+	  while (moves.next(move))
+	    {
+	      SplitTask task;
+	      task.split = &split;
+	      task.index = split.tasks.size();
+	      task.move  = move;
+	      split.tasks.push_back(task);
+	    }
+
+	  thread.splitPathID = split.id;
+
+	  searchSplitPoint(thread, split);
+	  isSplit=true;
+
+	  // the results are incomplete if the search was stopped
+
+	  if (aborted(thread)) { return 0; }
+
+	  mergeSplitTables(split);
+	}
     }
 
+  if (nMoves==0)
+    { return -EVAL_INFTY; }
+
   // insert into transposition-table
-  m_ttable->insert(board.getHash(), bestEval, TranspositionTable::boundType(bestEval, oldAlpha, beta),
-		   levels_to_go, bestMove, board);
+  if (useTT)
+    {
+      storeInTable(thread, hash, bestEval, TranspositionTable::boundType(bestEval, oldAlpha, beta),
+		   levels_to_go, toTable(bestMove, symmetry), board);
+    }
 
   if (ALGOTRACE)
     {
@@ -452,11 +1025,9 @@ float PlayerIF_AlgoAB::NegaMax(const Board& board,float alpha,float beta,
 }
 
 
-float PlayerIF_AlgoAB::Eval(const Board& board, int levelsToGo) const
+AlphaBetaSearch::eval_t AlphaBetaSearch::Eval(const Board& board, int levelsToGo) const
 {
-  m_nodesEvaluated++;
-
-  float eval = 0.0;
+  eval_t eval = 0;
 
   const Player me    = board.getCurrentPlayer();
   const Player other = opponent(me);
@@ -471,12 +1042,22 @@ float PlayerIF_AlgoAB::Eval(const Board& board, int levelsToGo) const
 
   // ========== freedom ==========
 
+  const PositionMask myPieces    = board.getPieces(me);
+  const PositionMask otherPieces = board.getPieces(other);
+
   int myFreedom =0;
   int oppFreedom=0;
-  for (int i=0;i<boardSpec.nPositions();i++)
+  if (board.hasEvalTerms())
     {
-      /**/ if (board.getPosition(i) == me)    myFreedom  += ruleSpec.freedomAtPosition(board,i);
-      else if (board.getPosition(i) == other) oppFreedom += ruleSpec.freedomAtPosition(board,i);
+      myFreedom  = board.getFreedom(me);
+      oppFreedom = board.getFreedom(other);
+    }
+  else
+    {
+      const PositionMask empty = boardSpec.getPositionsMask() & ~(myPieces | otherPieces);
+
+      for (PositionMask m=myPieces;    m; m&=m-1) myFreedom  += nPositionsInMask(boardSpec.getNeighborMask(firstPositionInMask(m)) & empty);
+      for (PositionMask m=otherPieces; m; m&=m-1) oppFreedom += nPositionsInMask(boardSpec.getNeighborMask(firstPositionInMask(m)) & empty);
     }
 
 
@@ -500,17 +1081,19 @@ float PlayerIF_AlgoAB::Eval(const Board& board, int levelsToGo) const
 
   int myMills=0;
   int otherMills=0;
-  for (int i=0;i< boardSpec.nMills(); i++)
+  if (board.hasEvalTerms())
     {
-      const MillPosVector& mill=boardSpec.getMill(i);
-
-      Player p0 = board.getPosition(mill[0]);
-      if (p0 != PL_None &&
-	  p0 == board.getPosition(mill[1]) &&
-	  p0 == board.getPosition(mill[2]))
+      myMills    = board.getNMills(me);
+      otherMills = board.getNMills(other);
+    }
+  else
+    {
+      for (int i=0;i< boardSpec.nMills(); i++)
 	{
-	  if (p0 == me) myMills++;
-	  else          otherMills++;
+	  const PositionMask mill=boardSpec.getMillMask(i);
+
+	  /**/ if ((myPieces    & mill) == mill) myMills++;
+	  else if ((otherPieces & mill) == mill) otherMills++;
 	}
     }
 
@@ -530,33 +1113,243 @@ float PlayerIF_AlgoAB::Eval(const Board& board, int levelsToGo) const
 }
 
 
-void PlayerIF_AlgoAB::logBestMoveFromTable(const Board& b, const Move& m, eval_t e, int depth) const
+/* A null move is only tried when zugzwang is unlikely: the opponent must not be able
+   to close a mill right away (the reduced null-move search would often not see the
+   follow-up), and we need enough moves such that one of them is probably harmless.
+ */
+bool AlphaBetaSearch::nullMoveIsSafe(SearchThread& thread, const Board& board) const
+{
+  Board opponentToMove = board;
+  opponentToMove.togglePlayer();
+
+  std::vector<Move>& moves = thread.scratchMoves;
+
+  moves.clear();
+  m_ruleSpec->generateMoves(moves, opponentToMove, RuleSpec::MillClosingMoves);
+  if (!moves.empty()) { return false; }
+
+  m_ruleSpec->generateMoves(moves, board);
+  return moves.size() >= NULLMOVE_MIN_MOBILITY;
+}
+
+
+/* The quiescence search only considers mill-closing moves. Since the player to move may
+   always decline to close a mill, the static evaluation is a lower bound of the value
+   ("stand pat"). Every mill-closing move takes a piece, hence the search terminates.
+ */
+AlphaBetaSearch::eval_t AlphaBetaSearch::Quiescence(SearchThread& thread, const Board& board,
+						    eval_t alpha, eval_t beta, int currDepth)
+{
+  thread.nodesQuiescence++;
+  thread.nodesSearched++;
+
+  if (board.getNPiecesLeft( board.getCurrentPlayer() )<3) { return -EVAL_INFTY; }
+
+  eval_t bestEval = Eval(board, 0);
+
+  if (bestEval>=beta || currDepth>=MAXSEARCHDEPTH-1)
+    { return bestEval; }
+
+  if (bestEval>alpha) { alpha=bestEval; }
+
+  StagedMoveGenerator moves(*m_ruleSpec, board, thread.moveStack);
+  moves.restrictToMillClosing();
+
+  Board tmpBoard = board;
+  Move  move;
+
+  while (moves.next(move))
+    {
+      tmpBoard.doMove(move);
+
+      eval_t recBeta  = beta;  subPly(recBeta);
+      eval_t recAlpha = alpha; subPly(recAlpha);
+      eval_t eval = -Quiescence(thread, tmpBoard, -recBeta, -recAlpha, currDepth+1);
+      addPly(eval);
+
+      tmpBoard.undoMove(move);
+
+      if (aborted(thread)) { return 0; }
+
+      if (eval>bestEval)
+	{
+	  bestEval=eval;
+
+	  if (bestEval>=beta) { break; }
+	  if (bestEval>alpha) { alpha=bestEval; }
+	}
+    }
+
+  return bestEval;
+}
+
+
+/* Search the position after a move. The returned value is from the view of the player
+   who made the move. With PVS, all moves except the first are searched with a null window
+   first, which only tells whether the move is better than alpha. Only if it is (and does not
+   cause a cut-off), it is searched again with the full window to get its exact value.
+   A reduced move is first searched with a null window and less depth, and only searched
+   again normally if it turns out to be better than alpha.
+ */
+AlphaBetaSearch::eval_t AlphaBetaSearch::searchMove(SearchThread& thread, const Board& afterMove,
+						    eval_t alpha, eval_t beta, int currDepth, int levels_to_go,
+						    Variation& childVar, bool useTT, bool firstMove,
+						    int reduction)
+{
+  eval_t eval;
+
+  if (reduction>0)
+    {
+      eval_t recBeta  = alpha+EVAL_NULLWINDOW; subPly(recBeta);
+      eval_t recAlpha = alpha;                 subPly(recAlpha);
+      eval = -NegaMax(thread, afterMove, -recBeta, -recAlpha, currDepth+1, levels_to_go-1-reduction,
+		      childVar, useTT);
+      addPly(eval);
+
+      if (eval<=alpha || aborted(thread))
+	{ return eval; }
+
+      childVar.clear();
+    }
+
+  if (m_usePVS && !firstMove && beta-alpha > EVAL_NULLWINDOW)
+    {
+      eval_t recBeta  = alpha+EVAL_NULLWINDOW; subPly(recBeta);
+      eval_t recAlpha = alpha;                 subPly(recAlpha);
+      eval = -NegaMax(thread, afterMove, -recBeta, -recAlpha, currDepth+1, levels_to_go-1, childVar, useTT);
+      addPly(eval);
+
+      if (eval<=alpha || eval>=beta || aborted(thread))
+	{ return eval; }
+
+      childVar.clear();
+    }
+
+  eval_t recBeta  = beta;  subPly(recBeta);
+  eval_t recAlpha = alpha; subPly(recAlpha);
+  eval = -NegaMax(thread, afterMove, -recBeta, -recAlpha, currDepth+1, levels_to_go-1, childVar, useTT);
+  addPly(eval);
+
+  return eval;
+}
+
+
+/* A board that already occurred on the search path is a draw, because the player who
+   repeated it can repeat it again. Boards from the game before the search only count
+   when the number of repetitions reaches the limit of the rules.
+ */
+bool AlphaBetaSearch::isRepetitionDraw(const SearchThread& thread) const
+{
+  const int nRepeats = m_ruleSpec->tieAfterNRepeats;
+  if (nRepeats==0)
+    return false;
+
+  const RepetitionStack& path = thread.repetitions;
+
+  return (path.nRepetitions(m_startHistory.size()-1) > 0 ||
+	  path.nRepetitions() >= nRepeats);
+}
+
+
+void AlphaBetaSearch::addExperience(eval_t& eval, const Board& afterMove) const
+{
+  if (m_experience!=NULL && abs(eval) < EVAL_WIN)
+    {
+      float offset = m_experience->getOffset( m_ruleSpec->getBoardID_Symmetric(afterMove), m_startBoard.getCurrentPlayer() );
+      offset *= m_weight[Weight_Experience];
+      eval += eval_t(floor(offset+0.5));
+    }
+}
+
+
+BoardHash AlphaBetaSearch::tableHash(const Board& board, SymmetricHashes& symHashes, int& symmetry) const
+{
+  if (m_searchSymmetric)
+    {
+      symHashes.update(board, *m_ruleSpec->boardSpec);
+      return symHashes.getHash(board, &symmetry);
+    }
+
+  symmetry=-1;
+  return board.getHash();
+}
+
+
+// positions that are not on the board (of a corrupted table move) are kept, they are rejected later
+static inline Position permutePosition(const BoardSpec::Permutation& perm, Position p)
+{
+  return (p>=0 && p<perm.size()) ? perm[p] : p;
+}
+
+static Move permuteMove(const BoardSpec::Permutation& perm, const Move& m)
+{
+  Move pm = m;
+
+  pm.newPos = permutePosition(perm, m.newPos);
+  if (m.mode==Move::Mode_Move) { pm.oldPos = permutePosition(perm, m.oldPos); }
+
+  for (int i=0;i<m.takes.size();i++)
+    pm.takes[i] = permutePosition(perm, m.takes[i]);
+
+  return pm;
+}
+
+Move AlphaBetaSearch::toTable(const Move& m, int symmetry) const
+{
+  if (symmetry<0 || m.newPos<0) return m;
+
+  return permuteMove(m_ruleSpec->boardSpec->getPermutations()[symmetry], m);
+}
+
+Move AlphaBetaSearch::fromTable(const Move& m, int symmetry) const
+{
+  if (symmetry<0 || m.newPos<0) return m;
+
+  const BoardSpec& spec = *m_ruleSpec->boardSpec;
+  return permuteMove(spec.getPermutations()[ spec.getInversePermutation(symmetry) ], m);
+}
+
+
+void AlphaBetaSearch::logBestMoveFromTable(const Board& b, const Move& m, eval_t e, int depth) const
+{
+  if (m_observer==NULL) { return; }
+
+  logBestMove(variationFromTable(b,m,depth),e,depth," <- from ttable");
+}
+
+
+// follow the best moves stored in the transposition table
+AlphaBetaSearch::Variation AlphaBetaSearch::variationFromTable(const Board& b, const Move& m, int depth) const
 {
   Board board = b;
   Move  move = m;
 
+  SymmetricHashes symHashes;
   Variation v;
 
-  for (int i=0;i<=depth;i++)
+  for (int i=0;i<=depth && v.size()<MAXSEARCHDEPTH;i++)
     {
+      if (!m_ruleSpec->isValidCompleteMove(board, move))
+	break;
+
       v.push_back(move);
 
       board.doMove(move);
 
-      const TranspositionTable::Entry* entry;
-      entry = m_ttable->lookup(board.getHash(), board);
-      if (entry)
+      int symmetry;
+      TranspositionTable::Entry entry;
+      if (m_ttable->lookup(tableHash(board, symHashes, symmetry), entry, board))
 	{
-	  move = entry->bestMove;
+	  move = fromTable(entry.bestMove.unpack(), symmetry);
 	}
       else
 	break;
     }
 
-  logBestMove(v,e,depth," <- from ttable");
+  return v;
 }
 
-void PlayerIF_AlgoAB::logBestMove(const Move& m, eval_t e, int depth) const
+void AlphaBetaSearch::logBestMove(const Move& m, eval_t e, int depth) const
 {
   Variation v;
   v.push_back(m);
@@ -564,8 +1357,10 @@ void PlayerIF_AlgoAB::logBestMove(const Move& m, eval_t e, int depth) const
 }
 
 
-void PlayerIF_AlgoAB::logBestMove(const Variation& v, eval_t e, int depth, const char* suffix) const
+void AlphaBetaSearch::logBestMove(const Variation& v, eval_t e, int depth, const char* suffix) const
 {
+  if (m_observer==NULL) { return; }
+
   std::stringstream strstr;
 
   Player p = m_startBoard.getCurrentPlayer();
@@ -577,7 +1372,7 @@ void PlayerIF_AlgoAB::logBestMove(const Variation& v, eval_t e, int depth, const
     }
 
   strstr << "(";
-  if (fabs(e) > EVAL_WIN)
+  if (abs(e) > EVAL_WIN)
     {
       strstr << e << " ";
 
@@ -590,11 +1385,7 @@ void PlayerIF_AlgoAB::logBestMove(const Variation& v, eval_t e, int depth, const
       if (winner==PL_White) player=_("white");
       else                  player=_("black");
 
-      int eInt = e;
-      int eAbs = (eInt < 0 ? -eInt : eInt);
-      int iInt = EVAL_INFTY;
-
-      int winInMoves = (iInt-1-eAbs)/2+1;
+      int winInMoves = (EVAL_INFTY-1-abs(e))/2+1;
 
       char buf[100];
       if (winInMoves>1) sprintf(buf, _("%s wins in %d moves)"), player, winInMoves);
@@ -605,16 +1396,42 @@ void PlayerIF_AlgoAB::logBestMove(const Variation& v, eval_t e, int depth, const
   else
     {
       if (m_startBoard.getCurrentPlayer() == PL_Black) e = -e;
-      strstr << e << ')';
+      strstr << float(e)/EVAL_SCALE << ')';
     }
 
   strstr << " [" << depth << "]" << suffix;
 
-  m_tunnel->showThinkingInfo(strstr.str());
+  m_observer->showThinkingInfo(strstr.str());
+}
+
+
+void AlphaBetaSearch::sendSearchInfo(const Variation& v, eval_t e, int depth) const
+{
+  if (m_observer==NULL) { return; }
+
+  struct timeval now;
+  gettimeofday(&now,NULL);
+
+  SearchInfo info;
+  info.depth = depth;
+  info.eval  = e;
+  info.winInMoves = 0;
+  if (abs(e) > EVAL_WIN)
+    {
+      info.winInMoves = (EVAL_INFTY-1-abs(e))/2+1;
+      if (e<0) info.winInMoves = -info.winInMoves;
+    }
+  info.nodes = nodesSearched();
+  info.msecs = timeDiff_ms(m_startTime, now);
+
+  for (int i=0;i<v.size();i++)
+    info.pv.push_back(v[i]);
+
+  m_observer->showSearchInfo(info);
 }
 
 
-void PlayerIF_AlgoAB::notifyWinner(Player p)
+void AlphaBetaSearch::learnFromGame(Player p, const GameRecord& record)
 {
   if (p==PL_None)
     {
@@ -626,13 +1443,11 @@ void PlayerIF_AlgoAB::notifyWinner(Player p)
       return;
     }
 
+  Board board = record.getStartBoard();
 
-  const GameControl& control = MainApp::app().getControl();
-
-  for (int i=0;i<control.getHistorySize()-1;i++)
+  for (int i=0;i<record.nMoves();i++)
     {
-      boost::shared_ptr<Board> board = control.getHistoryBoard(i);
-
-      m_experience->addBoard( m_ruleSpec->getBoardID_Symmetric(*board), p);
+      m_experience->addBoard( m_ruleSpec->getBoardID_Symmetric(board), p);
+      board.doMove(record.getMove(i));
     }
 }
@@ -19,12 +19,20 @@
 #ifndef ALGO_ALPHABETA_HH
 #define ALGO_ALPHABETA_HH
 
-#include "control.hh"
+#include "rules.hh"
+#include "repetition.hh"
+#include "gamerecord.hh"
+#include "searchinfo.hh"
 #include "ttable.hh"
+#include "movegen.hh"
 #include "learn.hh"
+#include "egdb.hh"
 
 #include <stdlib.h>
+#include <assert.h>
 #include <iostream>
+#include <vector>
+#include <deque>
 #include <glib.h>
 #include <sys/time.h>
 
@@ -32,31 +40,117 @@
 /* A quite standard alpha-beta search algo with a quite basic evaluation function.
    Still, it is a quite competitive player.
    Features:
-   - use of transposition table
+   - principal variation search and aspiration windows
+   - move ordering with hash move, killer moves, and history heuristic
+   - quiescence search over mill-closing moves
+   - optional null-move pruning (with verification) and late-move reductions
+   - use of transposition table, optionally shared between symmetric positions
+   - exact values from the endgame databases in the movement phase
    - PV display
    - learning of good/bad games and avoiding previous bad situations.
+   - parallel search with several threads, either sharing the transposition table
+     (lazy SMP), or deterministically distributing the moves at split points.
+
+   The search itself is synchronous: search() returns when the search is finished and
+   does not need a main loop. It may be stopped from another thread with stop().
+   PlayerIF_AlgoAB (player_alphabeta.hh) runs it in a thread for the GUI.
  */
-class PlayerIF_AlgoAB : public PlayerIF
+class AlphaBetaSearch
 {
 public:
-  PlayerIF_AlgoAB();
+  AlphaBetaSearch();
+  ~AlphaBetaSearch();
 
-  typedef float eval_t;
+  typedef int eval_t;
+  enum { EVAL_SCALE=100 }; // evaluation of one piece of material
   typedef SmallVec<Move, MAXSEARCHDEPTH> Variation;
 
+  struct SearchLimits
+  {
+    SearchLimits() : maxDepth(25), maxMSecs(1000), maxNodes(0) { }
+
+    int  maxDepth;
+    int  maxMSecs;
+    long maxNodes;  // nodes of the main search thread, 0: no limit
+  };
+
+  struct SearchResult
+  {
+    Move      move;   // the best move (empty if there is no legal move)
+    eval_t    eval;   // result of the last completed iteration, from the view of the player to move
+    int       depth;  // depth of the last completed iteration
+    long      nodes;  // summed over all threads
+    int       msecs;
+    Variation pv;     // principal variation, starting with 'move'
+  };
+
   // --- configuration ---
 
+  void setRuleSpec(rulespec_ptr rs) { m_ruleSpec = rs; }
   void registerTTable(ttable_ptr tt) { m_ttable=tt; }
-  void registerThreadTunnel(ThreadTunnel& tunnel) { m_tunnel=&tunnel; }
   void registerExperience(experience_ptr e) { m_experience=e; }
 
-  // --- AI parameters ---
+  /* Endgame database with the exact values of positions in the movement phase.
+     It is only used if it was created for the current rules. Takes effect with the
+     next move. Set to NULL to disable. */
+  void registerEndgameDatabase(egdb_ptr db) { m_egdb=db; }
+
+  // Receives the progress of the searches (NULL for none).
+  void registerObserver(SearchObserver* o) { m_observer=o; }
 
-  void setMaxTime_msec(int msecs) { m_maxMSecs=msecs; }
-  void setMaxDepth(int d) { m_maxDepth=d; }
+  // --- AI parameters ---
 
-  int  askMaxTime_msec() const { return m_maxMSecs; }
-  int  askMaxDepth() const { return m_maxDepth; }
+  /* Number of search threads. The additional helper threads search the same position
+     and only communicate through the transposition table. Takes effect with the next move. */
+  void setNThreads(int n) { assert(n>=1); m_nThreads=n; }
+  int  askNThreads() const { return m_nThreads; }
+
+  /* How several threads share the work:
+     - Parallel_SharedTT: lazy SMP, the helper threads search the whole tree on their own.
+     - Parallel_SplitPoints: young brothers wait along the leftmost path of the tree. After
+       the first move of such a node has been searched, the remaining moves are searched in
+       parallel and the results are combined in move order. While the moves are searched,
+       the shared transposition table is only read. Each move is searched with the private
+       table of its thread (cleared before) and the killers and history of the splitting
+       thread, and its deep table entries are merged into the shared table afterwards.
+       Hence, for a fixed search depth, the result is reproducible.
+  */
+  enum ParallelMode { Parallel_SharedTT, Parallel_SplitPoints };
+
+  void setParallelMode(ParallelMode m) { m_parallelMode=m; }
+  ParallelMode askParallelMode() const { return m_parallelMode; }
+
+  /* Principal variation search: all moves except the first are searched with a null window
+     and only searched again with the full window if they turn out to be better. */
+  void setUsePVS(bool flag) { m_usePVS=flag; }
+  bool askUsePVS() const { return m_usePVS; }
+
+  /* Aspiration windows: search each iteration with a small window around the result of
+     the previous iteration, and widen it when the result falls outside. */
+  void setUseAspirationWindows(bool flag) { m_useAspiration=flag; }
+  bool askUseAspirationWindows() const { return m_useAspiration; }
+
+  /* Quiescence search: at the leaves, continue searching the mill-closing moves until
+     the position is quiet. */
+  void setUseQuiescence(bool flag) { m_useQuiescence=flag; }
+  bool askUseQuiescence() const { return m_useQuiescence; }
+
+  /* Reductions in the movement phase, both off by default. Null-move pruning skips a
+     move and takes a cut-off if the position is still too good for the opponent. Since
+     zugzwang is common in Morris, no null move is tried in positions with a mill threat
+     of the opponent or with few moves of our own, and each cut-off is verified by a
+     reduced-depth search.
+     Late-move reductions search the quiet moves at the end of the move list with less depth. */
+  void setUseNullMove(bool flag) { m_useNullMove=flag; }
+  bool askUseNullMove() const { return m_useNullMove; }
+  void setUseLateMoveReductions(bool flag) { m_useLMR=flag; }
+  bool askUseLateMoveReductions() const { return m_useLMR; }
+
+  /* Symmetric hashing: positions that are mirrored or rotated versions of each other
+     share their transposition-table entries. The best moves are stored for the
+     symmetric board with the lowest hash and transformed back on lookup. */
+  void setUseSymmetricHashing(bool flag) { m_useSymmetricHashing=flag; }
+  bool askUseSymmetricHashing() const { return m_useSymmetricHashing; }
 
   enum Weight {
     Weight_Material,
@@ -66,54 +160,185 @@ public:
     Weight_NWEIGHTS
   };
 
-  void  setEvalWeight(Weight w, float val) { m_weight[w] = val; }
-  float askEvalWeight(Weight w) const { return m_weight[w]; }
+  /* The weights are given relative to one piece of material. They are stored scaled to
+     the integer evaluation. */
+  void  setEvalWeight(Weight w, float val) { m_weight[w] = eval_t(val*EVAL_SCALE + (val<0 ? -0.5f : 0.5f)); }
+  float askEvalWeight(Weight w) const { return float(m_weight[w])/EVAL_SCALE; }
+
+  // --- searching ---
 
-  // --- standard methods ---
+  /* Search the best move for the player to move on 'board'. The history contains the
+     boards of the game so far, with 'board' on top (unless it is the intermediate board
+     of a partial move). The search runs in the calling thread (plus the helper threads)
+     and returns when one of the limits is reached or the search was stopped. */
+  SearchResult search(const Board& board, const RepetitionStack& history, const SearchLimits&);
 
-  bool isInteractivePlayer() const { return false; }
+  /* Stop the search as soon as some move has been found. Can be called from any thread.
+     The request stays until clearStop(), hence it also stops a search that has not yet
+     started. Applications that run the search in a thread call clearStop() before they
+     start the thread. */
+  void stop();
+  void clearStop();
 
   // start a new game
   void resetGame();
 
-  void startMove(const Board& curr, int moveID);
+  // learn from a finished game (only if an Experience is registered)
+  void learnFromGame(Player winner, const GameRecord& game);
 
-  // Carry out the move as soon as possible.
-  void forceMove();
+private:
+  struct SplitPoint;
+  struct SplitTask;
+
+  // state of one search thread
+
+  struct SearchThread
+  {
+    SearchThread() : algo(NULL), id(0), thread(NULL), nodesSearched(0), nodesEvaluated(0), nodesQuiescence(0), nodesEGDB(0),
+		     task(NULL), splitPathID(-1) { }
+
+    AlphaBetaSearch* algo;
+    int       id;          // 0 for the main search thread
+    GThread*  thread;      // only used for helper threads
+    MoveStack moveStack;   // move lists of all plies, reused between searches
+    MoveHistory history;   // killer moves and history counters
+    long      nodesSearched;   // all nodes of the current search
+    int       nodesEvaluated;  // leaves of the main search
+    int       nodesQuiescence; // nodes of the quiescence search
+    int       nodesEGDB;       // nodes looked up in the endgame database
+    RepetitionStack repetitions; // the game history and the boards of the current search path
+    std::vector<Move> scratchMoves; // temporary move list of the null-move tests
+
+    SplitTask* task;        // the split task that is running in this thread, NULL if none
+    ttable_ptr privateTable; // transposition table of the split tasks
+    int        splitPathID; // the split point whose search path is in 'repetitions', -1 for none
+
+    // one per ply, only used with symmetric hashing (the deepest plies share the last one)
+    SymmetricHashes symHashes[MAXSEARCHDEPTH];
+
+    bool isMainThread() const { return id==0; }
+
+    void clearSymmetricHashes()
+    {
+      for (int i=0;i<MAXSEARCHDEPTH;i++)
+	symHashes[i].clear();
+    }
+  };
 
-  // Cancel the current move (do not send the currently computed move).
-  void cancelMove();
+  // work-sharing at split points (Parallel_SplitPoints)
 
-  void notifyWinner(Player p);
+  struct SplitTableEntry // an entry of a task's private table, to be stored in the shared table
+  {
+    BoardHash   hash;
+    short       eval;
+    signed char depth;
+    signed char bound;
+    PackedMove  bestMove;
+  };
 
-private:
-  void doSearch();
+  struct SplitTask
+  {
+    SplitPoint* split;
+    int         index;     // position of the move in the move order
+    Move        move;
+    eval_t      eval;
+    Variation   variation;
+    std::vector<SplitTableEntry> tableEntries;
+  };
 
-  float NegaMax(const Board& board,float alpha,float beta,
-		int currDepth, int levels_to_go,Variation&, bool useTT);
+  struct SplitPoint
+  {
+    int          id;
+    const Board* board;
+    boost::shared_ptr<RepetitionStack> repetitions; // copy of the splitting thread's search path
+    MoveHistory  history;  // copy of the splitting thread's killers and history
+    eval_t alpha, beta;
+    int   currDepth, levels_to_go;
+
+    std::vector<SplitTask> tasks;
+    int   nPending;  // number of unfinished tasks
+    volatile int cutoff; // index of the first task with a beta cut-off, tasks.size() if none
+  };
 
-  float Eval(const Board& board, int levelsToGo) const;
+  bool canSplit(const SearchThread&, int levels_to_go) const;
+  void searchSplitPoint(SearchThread&, SplitPoint&);
+  void runSplitTask(SearchThread&, SplitTask&);
+  void mergeSplitTables(const SplitPoint&);
 
+  /* Access to the transposition table. Split tasks only read the shared table and
+     store their results in the private table of their thread. */
+  bool lookupTable(const SearchThread&, BoardHash, TranspositionTable::Entry&, const Board&) const;
+  void storeInTable(SearchThread&, BoardHash, eval_t, TranspositionTable::BoundType, int depth,
+		    const Move& bestMove, const Board&);
+
+  int m_nextSplitID;
+
+  GMutex m_poolMutex; // protects the task queue and the state of the split points
+  GCond  m_poolCond;
+  std::deque<SplitTask*> m_taskQueue;
+
+
+  void doHelperSearch(SearchThread&);
+  void doWorkerLoop(SearchThread&);
+
+  eval_t NegaMax(SearchThread&, const Board& board, eval_t alpha, eval_t beta,
+		 int currDepth, int levels_to_go,Variation&, bool useTT, bool allowNullMove=true);
+  eval_t searchMove(SearchThread&, const Board& afterMove, eval_t alpha, eval_t beta,
+		    int currDepth, int levels_to_go, Variation&, bool useTT, bool firstMove,
+		    int reduction=0);
+  eval_t Quiescence(SearchThread&, const Board& board, eval_t alpha, eval_t beta, int currDepth);
+  bool   nullMoveIsSafe(SearchThread&, const Board& board) const;
+
+  /* The transposition-table hash of a board, and the permutation (-1 for none) that
+     transforms its moves into the moves stored in the table. With symmetric hashing,
+     'symHashes' is updated to the board. */
+  BoardHash tableHash(const Board&, SymmetricHashes& symHashes, int& symmetry) const;
+  Move      toTable  (const Move&, int symmetry) const;
+  Move      fromTable(const Move&, int symmetry) const;
+
+  eval_t Eval(const Board& board, int levelsToGo) const;
+  void  addExperience(eval_t& eval, const Board& afterMove) const;
+
+  bool  isRepetitionDraw(const SearchThread&) const;
+
+
+  rulespec_ptr m_ruleSpec;
 
   Board m_startBoard;
+  RepetitionStack m_startHistory; // game history, with m_startBoard on top
+  SearchLimits m_limits;
   Move  m_move;       // the move that is currently computed
 
+  SearchThread m_mainThread;
+  std::vector<boost::shared_ptr<SearchThread> > m_helperThreads;
+
   //PositionMemory m_posMemory;  // TODO: disabled, because not as effective as Experience
   experience_ptr m_experience;
 
   // multi-threading management
 
-  friend void startSearchThread(class PlayerIF_AlgoAB*);
-  void installJoinThreadHandler();
-  void joinThread();
+  friend void startHelperThread(SearchThread*);
+
+  void startHelperThreads();
+  void stopHelperThreads();  // called from the main search thread
+  long nodesSearched() const; // summed over all threads
 
-  class ThreadTunnel* m_tunnel;
-  GThread* thread;
-  int  m_moveID;
+  /* A stopped search unwinds: every node returns immediately after its child searches.
+     The returned values are meaningless, but they are neither used nor stored in the
+     transposition table. The main thread only stops after it has found some move. */
+  bool aborted(const SearchThread& t) const
+  {
+    return ((!t.isMainThread() && m_stopHelpers) ||
+	    ((m_limitReached || g_atomic_int_get(&m_stopRequest)) && m_computedSomeMove) ||
+	    (t.task && t.task->index > t.task->split->cutoff)); // result not needed anymore
+  }
 
-  bool m_stopThread;
-  bool m_ignoreMove;
+  SearchObserver* m_observer;
+
+  volatile gint m_stopRequest;
+  volatile bool m_limitReached; // the thinking time or the number of nodes is used up
   bool m_computedSomeMove;
+  volatile bool m_stopHelpers;
 
   // time management
 
@@ -123,19 +348,26 @@ private:
   // configuration
 
   ttable_ptr m_ttable;
-  int m_maxMSecs;
-  int m_maxDepth;
-  float m_weight[Weight_NWEIGHTS];
+  egdb_ptr   m_egdb;
+  egdb_ptr   m_searchEGDB; // the database used in the current search (NULL if not matching the rules)
+  int m_nThreads;
+  ParallelMode m_parallelMode;
+  bool m_usePVS;
+  bool m_useAspiration;
+  bool m_useQuiescence;
+  bool m_useNullMove;
+  bool m_useLMR;
+  bool m_useSymmetricHashing;
+  bool m_searchSymmetric; // symmetric hashing is used in the current search
+  eval_t m_weight[Weight_NWEIGHTS];
 
   // visualization
 
   void logBestMove(const Variation&, eval_t, int depth, const char* suffix="") const;
   void logBestMove(const Move&, eval_t, int depth) const;
   void logBestMoveFromTable(const Board&, const Move&, eval_t, int depth) const;
-
-  // statistics
-
-  mutable int  m_nodesEvaluated;
+  Variation variationFromTable(const Board&, const Move&, int depth) const;
+  void sendSearchInfo(const Variation&, eval_t, int depth) const;
 
   // debug
   int moveCnt;
@@ -20,7 +20,7 @@
 #include "mainapp.hh"
 
 
-void PlayerIF_AlgoRandom::startMove(const Board& current, int moveID)
+void PlayerIF_AlgoRandom::startMove(const Board& current, const RepetitionStack& history, int moveID)
 {
   std::vector<Move> moves;
   m_ruleSpec->generateMoves(moves, current);
@@ -36,7 +36,7 @@ public:
 
   bool isInteractivePlayer() const { return false; }
 
-  void startMove(const Board& current, int moveID);
+  void startMove(const Board& current, const RepetitionStack& history, int moveID);
 
   void forceMove() { }
   void cancelMove() { }
@@ -19,7 +19,7 @@
 #include "app_configmgr.hh"
 #include "mainapp.hh"
 #include "gtk_menutoolbar.hh"  // TODO: gtk is a special implementation !
-#include "algo_alphabeta.hh"
+#include "player_alphabeta.hh"
 
 ConfigManager_Application::ConfigManager_Application()
 {
@@ -93,6 +93,22 @@ void ConfigManager_Application::readInitialValues()
 
   store(ai_settings, itemComputers_shareTTables,
         read_bool(ai_settings, itemComputers_shareTTables));
+
+  /* Since store() ignores unchanged values, the table size and the parallel
+     search options (for which there are no matching defaults in the application)
+     are set directly. */
+  MainApp::app().setTTableSize_MB(read_int(ai_settings, itemComputers_ttableSize));
+
+  for (int i=0;i<2;i++)
+    {
+      PlayerIF_AlgoAB* p = dynamic_cast<PlayerIF_AlgoAB*>(MainApp::app().getAIPlayer(i).get());
+
+      p->getSearch().setNThreads(read_int(ai_settings, itemComputers_nThreads));
+      p->getSearch().setParallelMode(read_bool(ai_settings, itemComputers_reproducibleParallel) ?
+				     AlphaBetaSearch::Parallel_SplitPoints : AlphaBetaSearch::Parallel_SharedTT);
+    }
+
+  MainApp::app().setEndgameDatabaseDirectory(read_string(ai_settings, itemComputers_egdbDirectory));
 }
 
 void ConfigManager_Application::store(GSettings* settings, const char* key, int   value)
@@ -118,9 +134,22 @@ void ConfigManager_Application::store(GSettings* settings, const char* key, int
 	    p->setMaxDepth(value);
 	    return;
 	  }
+	else if (cmp(key,itemComputers_nThreads))
+	  {
+	    p->getSearch().setNThreads(value); // applies to both players
+	  }
       }
+
+    if (cmp(key,itemComputers_nThreads))
+      return;
   }
 
+  if (cmp(key,itemComputers_ttableSize))
+    {
+      MainApp::app().setTTableSize_MB(value);
+      return;
+    }
+
   if (m_delegate != NULL)
     {
       m_delegate->store(settings, key, value);
@@ -143,6 +172,14 @@ void ConfigManager_Application::store(GSettings* settings, const char* key, bool
     {
       MainApp::app().setShareTTables(value);
     }
+  else if (cmp(key,itemComputers_reproducibleParallel))
+    {
+      for (int i=0;i<2;i++)
+	{
+	  dynamic_cast<PlayerIF_AlgoAB*>(MainApp::app().getAIPlayer(i).get())->getSearch()
+	    .setParallelMode(value ? AlphaBetaSearch::Parallel_SplitPoints : AlphaBetaSearch::Parallel_SharedTT);
+	}
+    }
   else if (m_delegate != NULL)
     {
       m_delegate->store(settings,key,value);
@@ -158,26 +195,26 @@ void ConfigManager_Application::store(GSettings* settings, const char* key, floa
 
   for (int i=0;i<2;i++)
     {
-      PlayerIF_AlgoAB* p = dynamic_cast<PlayerIF_AlgoAB*>(MainApp::app().getAIPlayer(i).get());
+      AlphaBetaSearch& search = dynamic_cast<PlayerIF_AlgoAB*>(MainApp::app().getAIPlayer(i).get())->getSearch();
 
       if (cmp(key,itemComputer_weightMaterial[i]))
 	{
-	  p->setEvalWeight(PlayerIF_AlgoAB::Weight_Material, value);
+	  search.setEvalWeight(AlphaBetaSearch::Weight_Material, value);
 	  return;
 	}
       else if (cmp(key,itemComputer_weightFreedom[i]))
 	{
-	  p->setEvalWeight(PlayerIF_AlgoAB::Weight_Freedom, value);
+	  search.setEvalWeight(AlphaBetaSearch::Weight_Freedom, value);
 	  return;
 	}
       else if (cmp(key,itemComputer_weightMills[i]))
 	{
-	  p->setEvalWeight(PlayerIF_AlgoAB::Weight_Mills, value);
+	  search.setEvalWeight(AlphaBetaSearch::Weight_Mills, value);
 	  return;
 	}
       else if (cmp(key,itemComputer_weightExperience[i]))
 	{
-	  p->setEvalWeight(PlayerIF_AlgoAB::Weight_Experience, value);
+	  search.setEvalWeight(AlphaBetaSearch::Weight_Experience, value);
 	  return;
 	}
     }
@@ -196,6 +233,13 @@ void ConfigManager_Application::store(GSettings* settings, const char* key, cons
   if (strcmp(read_string(settings,key).c_str(),value)==0)
     return;
 
+  if (cmp(key,itemComputers_egdbDirectory))
+    {
+      g_settings_set_string(settings,key,value);
+      MainApp::app().setEndgameDatabaseDirectory(value);
+      return;
+    }
+
   if (m_delegate != NULL)
     {
       m_delegate->store(settings,key,value);
@@ -219,6 +263,14 @@ float ConfigManager_Application::read_float(GSettings* settings, const char* key
 
 std::string ConfigManager_Application::read_string(GSettings* settings, const char* key)
 {
+  if (cmp(key,itemComputers_egdbDirectory))
+    {
+      gchar* value = g_settings_get_string(settings,key);
+      std::string str(value);
+      g_free(value);
+      return str;
+    }
+
   if (m_delegate != NULL)
     {
       return m_delegate->read_string(settings,key);
@@ -21,6 +21,14 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/type_traits/has_trivial_assign.hpp>
+
+
+// boards are copied a lot in the search, this has to stay a plain copy of the memory
+BOOST_STATIC_ASSERT(boost::has_trivial_copy<Board>::value);
+BOOST_STATIC_ASSERT(boost::has_trivial_assign<Board>::value);
 
 
 bool Move::operator==(const Move& m) const
@@ -92,8 +100,7 @@ void Board::initHashValues()
 
 void Board::reset(int p_nPiecesToSet)
 {
-  for (int i=0;i<MAXPOSITIONS;i++)
-    { boardPos[i]=PL_None; }
+  pieces[0]=pieces[1]=0;
 
   currentPlayer = PL_White;
 
@@ -102,13 +109,112 @@ void Board::reset(int p_nPiecesToSet)
 
   hash = hash_nToSet[0][p_nPiecesToSet] ^ hash_nToSet[2][p_nPiecesToSet];
 
-  prev.reset();
+  spec=NULL;
+}
+
+
+void Board::setPieces(PositionMask white, PositionMask black, Player current,
+		      int nWhiteToSet, int nBlackToSet)
+{
+  assert((white & black)==0);
+
+  pieces[ player2Index(PL_White) ] = white;
+  pieces[ player2Index(PL_Black) ] = black;
+
+  currentPlayer = current;
+
+  nPiecesToSet  [ player2Index(PL_White) ] = nWhiteToSet;
+  nPiecesToSet  [ player2Index(PL_Black) ] = nBlackToSet;
+  nPiecesOnBoard[ player2Index(PL_White) ] = nPositionsInMask(white);
+  nPiecesOnBoard[ player2Index(PL_Black) ] = nPositionsInMask(black);
+
+  hash = hashFromScratch();
+
+  spec=NULL;
+}
+
+
+void Board::attachBoardSpec(const BoardSpec* s)
+{
+  spec=s;
+
+  if (spec==NULL)
+    return;
+
+  const PositionMask empty = spec->getPositionsMask() & ~getOccupied();
+
+  for (int pl=0;pl<2;pl++)
+    {
+      freedom[pl]=0;
+      for (PositionMask m=pieces[pl]; m; m&=m-1)
+	freedom[pl] += nPositionsInMask(spec->getNeighborMask(firstPositionInMask(m)) & empty);
+
+      nMills[pl]=0;
+      for (int i=0;i<spec->nMills();i++)
+	if ((pieces[pl] & spec->getMillMask(i)) == spec->getMillMask(i))
+	  nMills[pl]++;
+    }
+}
+
+
+/* Count the mills through position p for which all other positions are occupied by 'pieces'. */
+static inline int nClosedMillsThroughPos(const BoardSpec* spec, Position p, PositionMask pieces)
+{
+  const PositionMask* mills = spec->getMillPartnerMasks(p);
+  const int nMills = spec->nMillsThroughPos(p);
+
+  int cnt=0;
+  for (int i=0;i<nMills;i++)
+    if ((pieces & mills[i]) == mills[i])
+      { cnt++; }
+
+  return cnt;
+}
+
+
+inline void Board::addPiece(Position p, int playerIndex)
+{
+  if (spec)
+    {
+      const PositionMask neighbors = spec->getNeighborMask(p);
+
+      // the neighbors lose position p as free position
+      freedom[0] -= nPositionsInMask(neighbors & pieces[0]);
+      freedom[1] -= nPositionsInMask(neighbors & pieces[1]);
+
+      // freedom of the new piece
+      freedom[playerIndex] += nPositionsInMask(neighbors & ~getOccupied());
+
+      nMills[playerIndex] += nClosedMillsThroughPos(spec, p, pieces[playerIndex]);
+
+    }
+
+  pieces[playerIndex] |= positionBit(p);
+}
+
+
+inline void Board::removePiece(Position p, int playerIndex)
+{
+  pieces[playerIndex] &= ~positionBit(p);
+
+  if (spec)
+    {
+      const PositionMask neighbors = spec->getNeighborMask(p);
+
+      // exact inverse of addPiece()
+      freedom[playerIndex] -= nPositionsInMask(neighbors & ~getOccupied());
+
+      freedom[0] += nPositionsInMask(neighbors & pieces[0]);
+      freedom[1] += nPositionsInMask(neighbors & pieces[1]);
+
+      nMills[playerIndex] -= nClosedMillsThroughPos(spec, p, pieces[playerIndex]);
+    }
 }
 
 
 void Board::doMove(const Move& m)
 {
-  assert(boardPos[m.newPos] == PL_None);
+  assert(isEmpty(m.newPos));
 
   // set new piece or move existing piece
 
@@ -120,7 +226,7 @@ void Board::doMove(const Move& m)
 
 	assert(nPiecesToSet[playerIndex]>0);
 
-	boardPos[m.newPos] = currentPlayer;
+	addPiece(m.newPos, playerIndex);
 	hash ^= hash_pos [currentPlayer+1][m.newPos];
 	hash ^= hash_nToSet[currentPlayer+1][ nPiecesToSet[playerIndex]  ];
 	hash ^= hash_nToSet[currentPlayer+1][ nPiecesToSet[playerIndex]-1];
@@ -132,8 +238,8 @@ void Board::doMove(const Move& m)
 
     case Move::Mode_Move:
       {
-	boardPos[m.oldPos] = PL_None;
-	boardPos[m.newPos] = currentPlayer;
+	removePiece(m.oldPos, player2Index(currentPlayer));
+	addPiece   (m.newPos, player2Index(currentPlayer));
 	hash ^= hash_pos[currentPlayer+1][m.oldPos];
 	hash ^= hash_pos[currentPlayer+1][m.newPos];
       }
@@ -144,9 +250,9 @@ void Board::doMove(const Move& m)
 
   for (int i=0; i<m.takes.size(); i++)
     {
-      assert(boardPos[m.takes[i]] == opponent(currentPlayer));
+      assert(isOpponent(m.takes[i]));
 
-      boardPos[m.takes[i]] = PL_None;
+      removePiece(m.takes[i], player2Index(opponent(currentPlayer)));
       nPiecesOnBoard[ player2Index(opponent(currentPlayer)) ]--;
 
       hash ^= hash_pos[opponent(currentPlayer)+1][m.takes[i]];
@@ -168,7 +274,7 @@ void Board::undoMove(const Move& m)
 
   for (int i=0; i<m.takes.size(); i++)
     {
-      boardPos[m.takes[i]] = opponent(currentPlayer);
+      addPiece(m.takes[i], player2Index(opponent(currentPlayer)));
       nPiecesOnBoard[ player2Index(opponent(currentPlayer)) ]++;
 
       hash ^= hash_pos[opponent(currentPlayer)+1][m.takes[i]];
@@ -182,7 +288,7 @@ void Board::undoMove(const Move& m)
       {
 	const int playerIndex = player2Index(currentPlayer);
 
-	boardPos[m.newPos] = PL_None;
+	removePiece(m.newPos, playerIndex);
 	hash ^= hash_pos   [currentPlayer+1][m.newPos];
 	hash ^= hash_nToSet[currentPlayer+1][ nPiecesToSet[playerIndex]  ];
 	hash ^= hash_nToSet[currentPlayer+1][ nPiecesToSet[playerIndex]+1];
@@ -192,8 +298,8 @@ void Board::undoMove(const Move& m)
       break;
 
     case Move::Mode_Move:
-      boardPos[m.oldPos] = currentPlayer;
-      boardPos[m.newPos] = PL_None;
+      removePiece(m.newPos, player2Index(currentPlayer));
+      addPiece   (m.oldPos, player2Index(currentPlayer));
       hash ^= hash_pos[currentPlayer+1][m.oldPos];
       hash ^= hash_pos[currentPlayer+1][m.newPos];
       break;
@@ -206,9 +312,9 @@ BoardHash Board::hashFromScratch() const
   BoardHash h = 0;
 
   for (int i=0;i<MAXPOSITIONS;i++)
-    if (boardPos[i] != PL_None)
+    if (getPosition(i) != PL_None)
       {
-	h ^= hash_pos[ boardPos[i]+1 ][i];
+	h ^= hash_pos[ getPosition(i)+1 ][i];
       }
 
   if (currentPlayer == PL_Black) { h ^= hash_playerToggle; }
@@ -230,14 +336,66 @@ bool Board::operator==(const Board& b) const
     {
       if (nPiecesToSet  [i] != b.nPiecesToSet  [i]) return false;
       if (nPiecesOnBoard[i] != b.nPiecesOnBoard[i]) return false;
+      if (pieces        [i] != b.pieces        [i]) return false;
     }
 
-  for (int i=0;i<MAXPOSITIONS;i++)
+  return true;
+}
+
+
+void SymmetricHashes::clear()
+{
+  pieces[0]=pieces[1]=0;
+  nHashes=0;
+
+  // these are the hashes of the empty board for any number of permutations
+  for (int k=0;k<MAXSYMMETRIES;k++)
+    hash[k]=0;
+}
+
+
+void SymmetricHashes::update(const Board& board, const BoardSpec& spec)
+{
+  const std::vector<BoardSpec::Permutation>& permutations = spec.getPermutations();
+  nHashes = permutations.size();
+
+  for (int pl=0;pl<2;pl++)
     {
-      if (boardPos[i] != b.boardPos[i]) return false;
+      for (PositionMask m = pieces[pl] ^ board.pieces[pl]; m; m&=m-1)
+	{
+	  const Position p = firstPositionInMask(m);
+
+	  for (int k=0;k<nHashes;k++)
+	    hash[k] ^= Board::hash_pos[2*pl][ permutations[k][p] ];
+	}
+
+      pieces[pl] = board.pieces[pl];
     }
+}
 
-  return true;
+
+BoardHash SymmetricHashes::getHash(const Board& board, int* symmetry) const
+{
+  assert(nHashes>0);
+  assert(pieces[0]==board.pieces[0] && pieces[1]==board.pieces[1]);
+
+  int best=0;
+  for (int k=1;k<nHashes;k++)
+    if (hash[k] < hash[best])
+      best=k;
+
+  if (symmetry) { *symmetry=best; }
+
+  // the remaining hash terms are the same for all symmetric boards
+
+  BoardHash h = hash[best];
+
+  if (board.currentPlayer == PL_Black) { h ^= Board::hash_playerToggle; }
+
+  h ^= Board::hash_nToSet[PL_White+1][ board.nPiecesToSet[ player2Index(PL_White) ] ];
+  h ^= Board::hash_nToSet[PL_Black+1][ board.nPiecesToSet[ player2Index(PL_Black) ] ];
+
+  return h;
 }
 
 
@@ -249,19 +407,19 @@ void Board::displayOnConsole() const
   pc[PL_Black] = 'B';
   pc[PL_None ] = ' ';
 
-  std::cout << " 7 " << pc[boardPos[0]] << " --------- " << pc[boardPos[1]] << " --------- " << pc[boardPos[2]] << "\n";
+  std::cout << " 7 " << pc[getPosition(0)] << " --------- " << pc[getPosition(1)] << " --------- " << pc[getPosition(2)] << "\n";
   std::cout << "   |           |           |\n";
-  std::cout << " 6 |   " << pc[boardPos[3]] << " ----- " << pc[boardPos[4]] << " ----- " << pc[boardPos[5]] <<  "   |\n";
+  std::cout << " 6 |   " << pc[getPosition(3)] << " ----- " << pc[getPosition(4)] << " ----- " << pc[getPosition(5)] <<  "   |\n";
   std::cout << "   |   |       |       |   |\n";
-  std::cout << " 5 |   |   " << pc[boardPos[6]] << " - " << pc[boardPos[7]] << " - " << pc[boardPos[8]] << "   |   |\n";
+  std::cout << " 5 |   |   " << pc[getPosition(6)] << " - " << pc[getPosition(7)] << " - " << pc[getPosition(8)] << "   |   |\n";
   std::cout << "   |   |   |       |   |   |\n";
-  std::cout << " 4 " << pc[boardPos[9]] << " - " << pc[boardPos[10]] << " - " << pc[boardPos[11]] << "       " << pc[boardPos[12]] << " - " << pc[boardPos[13]] << " - " << pc[boardPos[14]] << "\n";
+  std::cout << " 4 " << pc[getPosition(9)] << " - " << pc[getPosition(10)] << " - " << pc[getPosition(11)] << "       " << pc[getPosition(12)] << " - " << pc[getPosition(13)] << " - " << pc[getPosition(14)] << "\n";
   std::cout << "   |   |   |       |   |   |\n";
-  std::cout << " 3 |   |   " << pc[boardPos[15]] << " - " << pc[boardPos[16]] << " - " << pc[boardPos[17]] << "   |   |\n";
+  std::cout << " 3 |   |   " << pc[getPosition(15)] << " - " << pc[getPosition(16)] << " - " << pc[getPosition(17)] << "   |   |\n";
   std::cout << "   |   |       |       |   |\n";
-  std::cout << " 2 |   " << pc[boardPos[18]] << " ----- " << pc[boardPos[19]] << " ----- " << pc[boardPos[20]] << "   |\n";
+  std::cout << " 2 |   " << pc[getPosition(18)] << " ----- " << pc[getPosition(19)] << " ----- " << pc[getPosition(20)] << "   |\n";
   std::cout << "   |           |           |\n";
-  std::cout << " 1 " << pc[boardPos[21]] << " --------- " << pc[boardPos[22]] << " --------- " << pc[boardPos[23]] << "\n";
+  std::cout << " 1 " << pc[getPosition(21)] << " --------- " << pc[getPosition(22)] << " --------- " << pc[getPosition(23)] << "\n";
   std::cout << "   a   b   c   d   e   f   g\n";
 
   int wIdx = player2Index(PL_White);
@@ -21,11 +21,11 @@
 
 #include <assert.h>
 #include <vector>
-#include <boost/shared_ptr.hpp>
 #include <iostream>
 
 #include "util.hh"
 #include "constants.hh"
+#include "boardspec.hh"
 
 
 /* This class encodes a half-move of a player. The mode can either be setting
@@ -60,6 +60,70 @@ std::ostream& operator<<(std::ostream& ostr, const Move&);
 
 
 
+/* A compact 32-bit encoding of a Move, used in hash tables and for fast comparisons.
+   The new position, the old position, and up to three takes are stored in 6-bit
+   fields (in this order, starting at the lowest bits). Unused fields are set to
+   63, which also marks set-moves (no old position). Conversion to and from Move
+   is lossless.
+ */
+class PackedMove
+{
+public:
+  PackedMove() : bits(NoMove) { }
+  explicit PackedMove(const Move&);
+
+  Move unpack() const;
+
+  bool isNoMove() const { return bits==NoMove; }
+
+  // raw access for table storage
+  unsigned int      getBits() const { return bits; }
+  static PackedMove fromBits(unsigned int b) { PackedMove m; m.bits=b; return m; }
+
+  bool operator==(const PackedMove& m) const { return bits==m.bits; }
+  bool operator!=(const PackedMove& m) const { return bits!=m.bits; }
+
+private:
+  enum { FieldBits=6, Unused=63, NoMove=0x3FFFFFFF };
+
+  unsigned int bits;
+};
+
+
+inline PackedMove::PackedMove(const Move& m)
+{
+  bits  = (m.newPos<0 ? Unused : m.newPos);
+  bits |= (m.mode==Move::Mode_Move ? m.oldPos : Unused) << FieldBits;
+
+  for (int i=0;i<Move::MAXTAKES;i++)
+    bits |= (i<m.takes.size() ? m.takes[i] : Unused) << ((i+2)*FieldBits);
+}
+
+
+inline Move PackedMove::unpack() const
+{
+  Move m;
+  m.reset();
+
+  Position newPos =  bits              & Unused;
+  Position oldPos = (bits>>FieldBits)  & Unused;
+
+  if (oldPos==Unused) { m.setMove_Set(newPos==Unused ? -1 : newPos); }
+  else                { m.setMove_Move(oldPos,newPos); }
+
+  for (int i=0;i<Move::MAXTAKES;i++)
+    {
+      Position take = (bits>>((i+2)*FieldBits)) & Unused;
+      if (take==Unused) break;
+
+      m.addTake(take);
+    }
+
+  return m;
+}
+
+
+
 typedef unsigned long long BoardHash;
 
 /* The board class hold the current configuation of the players' pieces, as well as
@@ -67,16 +131,32 @@ typedef unsigned long long BoardHash;
    each player can still set. The Board class also maintains a hash-code for the
    board using the Zobrist hashing algorithm.
 
-   Additionally, the board can include a pointer to the previous board (in a running game).
-   This is used to detect ties by repeated board positions.
+   The pieces are stored as one position bit-mask per player. This allows the
+   move generator and the evaluation to work on whole sets of positions at once.
+
+   The board does not know about the previous boards of the game. These are kept in a
+   GameRecord (gamerecord.hh), and repetitions are detected with a RepetitionStack.
+   Hence, the board is a plain structure that is copied by copying its memory, which
+   makes the many board copies in the search cheap.
+
+   Optionally, the board can maintain the freedom and closed-mill counts of both players
+   incrementally in doMove()/undoMove(). This requires the board topology and is enabled
+   by attaching the BoardSpec with attachBoardSpec().
 
    NOTE: you have to call reset() before the board is in a playable state.
  */
 class Board
 {
 public:
+  Board() : spec(NULL) { }
+
   void reset(int nPiecesToSet);
 
+  /* Set up a position with the given pieces. Without pieces left to set, this is a position
+     of the movement phase. The board is detached from the board topology. */
+  void setPieces(PositionMask white, PositionMask black, Player current,
+		 int nWhiteToSet=0, int nBlackToSet=0);
+
   void doMove(const Move&);
   void undoMove(const Move&);
 
@@ -90,11 +170,19 @@ public:
 
   // --- querying the board ---
 
-  Player getPosition(int p) const { return Player(boardPos[p]); }
+  Player getPosition(int p) const { return Player(int((pieces[1]>>p)&1) - int((pieces[0]>>p)&1)); }
+
+  bool   isPlayer  (Position p) const { return getPieces()         & positionBit(p); }
+  bool   isOpponent(Position p) const { return getOpponentPieces() & positionBit(p); }
+  bool   isEmpty   (Position p) const { return !(getOccupied()     & positionBit(p)); }
+
+
+  // --- position masks ---
 
-  bool   isPlayer  (Position p) const { return boardPos[p]==currentPlayer; }
-  bool   isOpponent(Position p) const { return boardPos[p]==opponent(currentPlayer); }
-  bool   isEmpty   (Position p) const { return boardPos[p]==PL_None; }
+  PositionMask getPieces(Player p) const { return pieces[ player2Index(p) ]; }
+  PositionMask getPieces() const { return pieces[ player2Index(currentPlayer) ]; }
+  PositionMask getOpponentPieces() const { return pieces[ player2Index(opponent(currentPlayer)) ]; }
+  PositionMask getOccupied() const { return pieces[0] | pieces[1]; }
 
 
   // --- counting pieces ---
@@ -109,10 +197,18 @@ public:
   short  getNPiecesLeft() const { return getNPiecesLeft(currentPlayer); }
 
 
-  // --- chaining ---
+  // --- incrementally maintained evaluation terms ---
 
-  void   setPrevBoard(boost::shared_ptr<Board> b) { prev=b; }
-  boost::shared_ptr<Board> getPrevBoard() const { return prev; }
+  /* Attach the board topology (or NULL to switch off) and compute the terms from scratch.
+     The BoardSpec has to outlive the board and all its copies. */
+  void   attachBoardSpec(const BoardSpec*);
+  bool   hasEvalTerms() const { return spec!=NULL; }
+
+  // Number of empty neighbors, summed over all pieces of the player.
+  short  getFreedom(Player p) const { return freedom[ player2Index(p) ]; }
+
+  // Number of mills that are closed by the player.
+  short  getNMills(Player p) const { return nMills[ player2Index(p) ]; }
 
 
   // --- hashes ---
@@ -121,9 +217,14 @@ public:
   static void initHashValues(); // fill the hash tables with random values
 
 
-  // --- hard board modification, not considering the hash value ---
+  // --- hard board modification, not considering the hash value and the evaluation terms ---
 
-  void   setPosition_noHash(int p, Player pl) { boardPos[p]=pl; }
+  void   setPosition_noHash(int p, Player pl)
+  {
+    pieces[0] &= ~positionBit(p);
+    pieces[1] &= ~positionBit(p);
+    if (pl != PL_None) { pieces[ player2Index(pl) ] |= positionBit(p); }
+  }
 
 
   // --- standard operators ---
@@ -138,12 +239,20 @@ public:
   void   displayOnConsole() const;
 
 private:
-  signed char boardPos[MAXPOSITIONS];
-  Player      currentPlayer;
-  signed char nPiecesToSet[2];
-  signed char nPiecesOnBoard[2];
+  PositionMask pieces[2];  // indexed by player2Index()
+  Player       currentPlayer;
+  signed char  nPiecesToSet[2];
+  signed char  nPiecesOnBoard[2];
+
 
-  boost::shared_ptr<Board> prev;
+  // --- evaluation terms ---
+
+  const BoardSpec* spec;  // NULL if the evaluation terms are not maintained
+  short freedom[2];
+  short nMills[2];
+
+  inline void addPiece   (Position, int playerIndex);
+  inline void removePiece(Position, int playerIndex);
 
 
   // --- hash ---
@@ -159,6 +268,39 @@ private:
   static BoardHash hash_playerToggle; // xor'ed to hash if player is PL_Black
 
   BoardHash hashFromScratch() const; // for debugging only
+
+  friend class SymmetricHashes;
+};
+
+
+/* The hashes of the boards that are obtained with each of the permutations of
+   BoardSpec::getPermutations(). They are kept outside of the board, because they are
+   only needed for the transposition table of some searches, while the board is copied
+   at every node.
+
+   update() only rehashes the positions whose pieces differ from the last board that was
+   hashed. Hence, the search reuses one object for all boards of a ply.
+ */
+class SymmetricHashes
+{
+public:
+  SymmetricHashes() { clear(); }
+
+  void clear(); // forget the last board
+
+  void update(const Board&, const BoardSpec&);
+
+  /* A hash that is the same for all boards that are symmetric to each other (the minimum
+     over the symmetric boards). 'symmetry' is set to the permutation that maps the board
+     to the board with the minimum hash. The board has to be the last updated one. */
+  BoardHash getHash(const Board&, int* symmetry=NULL) const;
+
+private:
+  PositionMask pieces[2]; // of the last board
+  int          nHashes;
+
+  // the hashes of the positions of the pieces on the permuted boards (without the other hash terms)
+  BoardHash    hash[MAXSYMMETRIES];
 };
 
 #endif
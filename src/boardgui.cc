@@ -290,7 +290,7 @@ void BoardGUI_Base::setHover(HoverMode mode, Position pos, bool valid)
 
 // ---------------------------------------------------------------------------
 
-void PlayerIF_Human::startMove(const Board& current, int moveID)
+void PlayerIF_Human::startMove(const Board& current, const RepetitionStack& history, int moveID)
 {
   MainApp::app().getBoardGUI()->startInteractiveMove();
 }
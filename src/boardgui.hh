@@ -140,7 +140,7 @@ public:
 
   bool isInteractivePlayer() const { return true; }
 
-  void startMove(const Board& current, int moveID);
+  void startMove(const Board& current, const RepetitionStack& history, int moveID);
   void forceMove() { }
   void cancelMove();
 };
@@ -0,0 +1,245 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "boardrank.hh"
+
+#include <assert.h>
+
+
+// --- binomial coefficients ---
+
+static BoardIndex binomialTable[MAXPOSITIONS+1][MAXPOSITIONS+1];
+static bool       binomialTableInitialized = false;
+
+static void initBinomialTable()
+{
+  if (binomialTableInitialized)
+    return;
+
+  for (int n=0;n<=MAXPOSITIONS;n++)
+    {
+      binomialTable[n][0]=1;
+      for (int k=1;k<=MAXPOSITIONS;k++)
+	binomialTable[n][k] = (n==0 ? 0 : binomialTable[n-1][k-1] + binomialTable[n-1][k]);
+    }
+
+  binomialTableInitialized = true;
+}
+
+static inline BoardIndex binomial(int n, int k) { return binomialTable[n][k]; }
+
+
+/* Rank of a set of positions among all sets with the same number of elements
+   (combinatorial number system). */
+static inline BoardIndex rankSet(PositionMask set)
+{
+  BoardIndex rank=0;
+  int i=1;
+  for (PositionMask m=set; m; m&=m-1, i++)
+    rank += binomial(firstPositionInMask(m), i);
+
+  return rank;
+}
+
+static inline PositionMask unrankSet(BoardIndex rank, int nElements, int nPositions)
+{
+  PositionMask set=0;
+
+  int p=nPositions-1;
+  for (int i=nElements;i>=1;i--)
+    {
+      while (binomial(p,i) > rank) p--;
+
+      rank -= binomial(p,i);
+      set |= positionBit(p);
+      p--;
+    }
+
+  return set;
+}
+
+
+/* Number the positions of 'set' by the positions that are left over by 'occupied'.
+   Position p is moved down by the number of occupied positions below it. */
+static inline PositionMask compressSet(PositionMask set, PositionMask occupied)
+{
+  PositionMask compressed=0;
+  for (PositionMask m=set; m; m&=m-1)
+    {
+      const Position p = firstPositionInMask(m);
+      compressed |= positionBit(p - nPositionsInMask(occupied & (positionBit(p)-1)));
+    }
+
+  return compressed;
+}
+
+// inverse of compressSet()
+static inline PositionMask expandSet(PositionMask compressed, PositionMask occupied, int nPositions)
+{
+  PositionMask set=0;
+  int idx=0;
+  for (int p=0;p<nPositions;p++)
+    {
+      if (occupied & positionBit(p)) continue;
+      if (compressed & positionBit(idx)) set |= positionBit(p);
+      idx++;
+    }
+
+  return set;
+}
+
+
+// --- BoardRanking ---
+
+BoardRanking::BoardRanking(int nPositions, int nWhite, int nBlack)
+  : m_nPositions(nPositions),
+    m_nWhite(nWhite),
+    m_nBlack(nBlack)
+{
+  assert(nWhite+nBlack <= nPositions);
+
+  initBinomialTable();
+
+  m_nBlackSets = binomial(nPositions-nWhite, nBlack);
+  m_size       = binomial(nPositions, nWhite) * m_nBlackSets;
+}
+
+
+BoardIndex BoardRanking::rank(PositionMask white, PositionMask black) const
+{
+  assert(nPositionsInMask(white)==m_nWhite);
+  assert(nPositionsInMask(black)==m_nBlack);
+
+  return rankSet(white) * m_nBlackSets + rankSet(compressSet(black, white));
+}
+
+
+void BoardRanking::unrank(BoardIndex index, PositionMask& white, PositionMask& black) const
+{
+  assert(index < m_size);
+
+  white = unrankSet(index / m_nBlackSets, m_nWhite, m_nPositions);
+  black = expandSet(unrankSet(index % m_nBlackSets, m_nBlack, m_nPositions-m_nWhite),
+		    white, m_nPositions);
+}
+
+
+// --- SymmetricBoardRanking ---
+
+SymmetricBoardRanking::SymmetricBoardRanking(boardspec_ptr spec, int nWhite, int nBlack)
+  : m_spec(spec),
+    m_nPositions(spec->nPositions()),
+    m_nWhite(nWhite),
+    m_nBlack(nBlack)
+{
+  assert(nWhite+nBlack <= m_nPositions);
+
+  initBinomialTable();
+
+  const int nPermutations = spec->getPermutations().size();
+  assert(nPermutations <= 64);
+
+  m_nBlackSets = binomial(m_nPositions-nWhite, nBlack);
+
+  const BoardIndex nWhiteSets = binomial(m_nPositions, nWhite);
+  assert(nWhiteSets < (1ULL<<32));
+
+  const unsigned int unassigned = ~0U;
+  m_classOfWhite.assign(nWhiteSets, unassigned);
+  m_toRepresentative.resize(nWhiteSets);
+
+  /* The white configurations are visited in the order of their ranks. Hence, the first
+     configuration of each class that we see is the one with the lowest rank, and we assign
+     the whole class when we visit it. */
+
+  for (BoardIndex r=0;r<nWhiteSets;r++)
+    {
+      if (m_classOfWhite[r] != unassigned)
+	continue;
+
+      const unsigned int cls = m_classWhite.size();
+      const PositionMask white = unrankSet(r, nWhite, m_nPositions);
+
+      unsigned long long stabilizer=0;
+
+      for (int i=0;i<nPermutations;i++)
+	{
+	  const PositionMask permuted = permute(white, i);
+	  const BoardIndex   s = rankSet(permuted);
+
+	  if (permuted == white)
+	    { stabilizer |= 1ULL<<i; }
+
+	  if (m_classOfWhite[s] == unassigned)
+	    {
+	      m_classOfWhite[s]     = cls;
+	      m_toRepresentative[s] = spec->getInversePermutation(i);
+	    }
+	}
+
+      m_classWhite.push_back(white);
+      m_classStabilizer.push_back(stabilizer);
+    }
+}
+
+
+PositionMask SymmetricBoardRanking::permute(PositionMask m, int permutation) const
+{
+  return m_spec->permuteMask(permutation, m);
+}
+
+
+BoardIndex SymmetricBoardRanking::rank(PositionMask white, PositionMask black) const
+{
+  assert(nPositionsInMask(white)==m_nWhite);
+  assert(nPositionsInMask(black)==m_nBlack);
+
+  const BoardIndex   r   = rankSet(white);
+  const unsigned int cls = m_classOfWhite[r];
+  const int          toRep = m_toRepresentative[r];
+
+  const PositionMask repWhite = m_classWhite[cls];
+  const PositionMask repBlack = permute(black, toRep);
+
+  assert(permute(white, toRep) == repWhite);
+
+  // among the symmetries of the representative, choose the lowest black rank
+
+  BoardIndex blackRank = rankSet(compressSet(repBlack, repWhite));
+
+  for (unsigned long long s = m_classStabilizer[cls]; s; s&=s-1)
+    {
+      const int i = __builtin_ctzll(s);
+      BoardIndex rk = rankSet(compressSet(permute(repBlack, i), repWhite));
+      if (rk < blackRank) blackRank = rk;
+    }
+
+  return cls * m_nBlackSets + blackRank;
+}
+
+
+bool SymmetricBoardRanking::unrank(BoardIndex index, PositionMask& white, PositionMask& black) const
+{
+  assert(index < size());
+
+  white = m_classWhite[ index / m_nBlackSets ];
+  black = expandSet(unrankSet(index % m_nBlackSets, m_nBlack, m_nPositions-m_nWhite),
+		    white, m_nPositions);
+
+  return rank(white, black) == index;
+}
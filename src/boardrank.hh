@@ -0,0 +1,116 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef BOARDRANK_HH
+#define BOARDRANK_HH
+
+#include "board.hh"
+#include "boardspec.hh"
+#include <vector>
+
+
+/* Dense numbering of the boards within a subspace with a fixed number of white and
+   black pieces on the board. The numbers of pieces to set and the player to move
+   are not part of the index. They select the subspace, together with the piece counts.
+
+   In contrast to RuleSpec::getBoardID(), the indices of a subspace are exactly
+   [0, C(n,w)*C(n-w,b)) for n positions, w white, and b black pieces. Hence, they can
+   directly be used as offsets into tables.
+
+   The two piece sets do not have to be white and black. For example, the endgame
+   databases rank the pieces of the player to move and of the opponent.
+ */
+
+typedef unsigned long long BoardIndex;
+
+
+class BoardRanking
+{
+public:
+  BoardRanking(int nPositions, int nWhite, int nBlack);
+
+  int        nWhite() const { return m_nWhite; }
+  int        nBlack() const { return m_nBlack; }
+  BoardIndex size()   const { return m_size; }
+
+  BoardIndex rank(PositionMask white, PositionMask black) const;
+  void       unrank(BoardIndex, PositionMask& white, PositionMask& black) const;
+
+  BoardIndex rank(const Board& b) const { return rank(b.getPieces(PL_White), b.getPieces(PL_Black)); }
+
+private:
+  int m_nPositions;
+  int m_nWhite, m_nBlack;
+
+  BoardIndex m_nBlackSets; // number of black configurations for each configuration of white
+  BoardIndex m_size;
+};
+
+
+/* The same numbering, but folded by the symmetries of the board (BoardSpec::getPermutations()).
+   All boards that are symmetric to each other receive the same index.
+
+   The white configurations are grouped into symmetry classes. Each class is represented by
+   its configuration with the lowest rank, and the boards are transformed such that white is
+   in this configuration. The index is the class number combined with the rank of the black
+   configuration, minimized over the symmetries that keep the white configuration unchanged.
+
+   The indices are nearly dense: for the few symmetric white configurations, some indices are
+   not used. There are about 1/(number of symmetries) times as many indices as for BoardRanking.
+
+   The construction takes a table of C(n,w) entries (5 bytes each), hence it is only feasible
+   when the number of white configurations is not too large.
+ */
+class SymmetricBoardRanking
+{
+public:
+  SymmetricBoardRanking(boardspec_ptr, int nWhite, int nBlack);
+
+  int        nWhite() const { return m_nWhite; }
+  int        nBlack() const { return m_nBlack; }
+  BoardIndex size()   const { return m_classWhite.size() * m_nBlackSets; }
+
+  int        nWhiteClasses() const { return m_classWhite.size(); }
+
+  BoardIndex rank(PositionMask white, PositionMask black) const;
+
+  /* Get the representative board of an index. Returns false if the index is not used,
+     i.e., the board ranks to a different index. */
+  bool       unrank(BoardIndex, PositionMask& white, PositionMask& black) const;
+
+  BoardIndex rank(const Board& b) const { return rank(b.getPieces(PL_White), b.getPieces(PL_Black)); }
+
+private:
+  boardspec_ptr m_spec;
+  int m_nPositions;
+  int m_nWhite, m_nBlack;
+
+  BoardIndex m_nBlackSets;
+
+  // for each white configuration (by rank): the class and the symmetry that leads to its representative
+  std::vector<unsigned int>  m_classOfWhite;
+  std::vector<unsigned char> m_toRepresentative;
+
+  // for each class: the representative and the symmetries that do not change it
+  std::vector<PositionMask>       m_classWhite;
+  std::vector<unsigned long long> m_classStabilizer; // bit i: permutation i
+
+  PositionMask permute(PositionMask, int permutation) const;
+};
+
+#endif
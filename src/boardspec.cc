@@ -18,6 +18,8 @@
 
 #include "boardspec.hh"
 #include <cmath>
+#include <new>
+#include <stdlib.h>
 
 
 BoardSpec_Polygon::BoardSpec_Polygon(int nCorners)
@@ -168,6 +170,7 @@ BoardSpec_Polygon::BoardSpec_Polygon(int nCorners)
     }
 
   initPermutations();
+  initMasks();
 }
 
 int BoardSpec_Polygon::nPositions() const
@@ -764,6 +767,7 @@ BoardSpec_Grid::BoardSpec_Grid(BoardPreset t)
     }
 
   initPermutations();
+  initMasks();
 }
 
 
@@ -864,6 +868,20 @@ std::vector<float>  BoardSpec_Grid::yCoords() const
   return coords;
 }
 
+void* BoardSpec::operator new(size_t size)
+{
+  void* mem;
+  if (posix_memalign(&mem, CACHELINE_SIZE, size) != 0)
+    { throw std::bad_alloc(); }
+
+  return mem;
+}
+
+void BoardSpec::operator delete(void* mem)
+{
+  free(mem);
+}
+
 boardspec_ptr BoardSpec::boardFactory(BoardSpec::BoardPreset preset)
 {
   BoardSpec* spec = NULL;
@@ -970,4 +988,87 @@ void BoardSpec::initPermutations()
   //std::cout << "--- BEGIN ---\n";
   recursePermutation(p, used, 0);
   //std::cout << "--- END ---\n";
+
+  assert(m_permutations.size() <= MAXSYMMETRIES);
+
+  // the search above finds the identity first
+  for (int p=0;p<nPositions();p++)
+    assert(m_permutations[0][p]==p);
+
+  // The permutations form a group, hence each one has an inverse in the set.
+
+  m_inversePermutation.assign(m_permutations.size(), -1);
+
+  for (int i=0;i<m_permutations.size();i++)
+    for (int j=0;j<m_permutations.size() && m_inversePermutation[i]<0;j++)
+      {
+	bool isInverse=true;
+	for (int p=0;p<nPositions() && isInverse;p++)
+	  if (m_permutations[j][ m_permutations[i][p] ] != p) isInverse=false;
+
+	if (isInverse) { m_inversePermutation[i]=j; }
+      }
+
+  // tables for permuteMask()
+
+  m_permutationTables.resize(m_permutations.size());
+
+  for (int i=0;i<m_permutations.size();i++)
+    for (int b=0;b<(MAXPOSITIONS+7)/8;b++)
+      for (int v=0;v<256;v++)
+	{
+	  PositionMask mask=0;
+	  for (int bit=0;bit<8;bit++)
+	    {
+	      const int pos = b*8+bit;
+	      if ((v & (1<<bit)) && pos<nPositions())
+		mask |= positionBit( m_permutations[i][pos] );
+	    }
+
+	  m_permutationTables[i].byteMap[b][v] = mask;
+	}
+}
+
+
+void BoardSpec::initMasks()
+{
+  m_positionsMask=0;
+
+  for (int p=0;p<nPositions();p++)
+    {
+      m_positionsMask |= positionBit(p);
+
+      const NeighborVector& n = getNeighbors(p);
+
+      m_neighborMask[p]=0;
+      for (int i=0;i<n.size();i++)
+	m_neighborMask[p] |= positionBit(n[i]);
+    }
+
+  m_millMask.resize(nMills());
+  for (int i=0;i<nMills();i++)
+    {
+      const MillPosVector& mill = getMill(i);
+
+      m_millMask[i]=0;
+      for (int k=0;k<mill.size();k++)
+	m_millMask[i] |= positionBit(mill[k]);
+    }
+
+  for (int p=0;p<nPositions();p++)
+    {
+      const std::vector<MillPosVector>& mills = getMillsThroughPos(p);
+      assert(mills.size() <= MAXMILLSPERPOS);
+
+      m_nMillsAtPos[p] = mills.size();
+
+      assert((size_t(m_millPartnerMask[p]) & (CACHELINE_SIZE-1)) == 0);
+
+      for (int i=0;i<mills.size();i++)
+	{
+	  m_millPartnerMask[p][i]=0;
+	  for (int k=0;k<mills[i].size();k++)
+	    m_millPartnerMask[p][i] |= positionBit(mills[i][k]);
+	}
+    }
 }
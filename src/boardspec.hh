@@ -43,6 +43,11 @@ class BoardSpec
 public:
   virtual ~BoardSpec() { }
 
+  /* The mill tables are aligned to cache-lines. As the default operator new does not
+     guarantee this alignment, board specifications are allocated by these. */
+  static void* operator new(size_t);
+  static void  operator delete(void*);
+
   // The number of positions on this board.
   virtual int                   nPositions() const = 0;
 
@@ -70,11 +75,43 @@ public:
 
   /* Return a set of position-permutation vectors for this board configuration.
      Permuting the board positions according to these permutations results
-     in symmetric situations.
+     in symmetric situations. The first permutation is the identity.
   */
   typedef SmallVec<Position, MAXPOSITIONS> Permutation;
   const std::vector<Permutation>& getPermutations() const { return m_permutations; }
 
+  // The index of the permutation that reverts permutation 'i'.
+  int getInversePermutation(int i) const { return m_inversePermutation[i]; }
+
+  /* Apply permutation 'i' to a set of positions, i.e. position p is moved to
+     getPermutations()[i][p]. This uses precomputed tables for each byte of the mask. */
+  PositionMask permuteMask(int i, PositionMask m) const
+  {
+    const PermutationTable& t = m_permutationTables[i];
+    PositionMask result=0;
+    for (int b=0; m; b++, m>>=8)
+      result |= t.byteMap[b][m & 0xFF];
+    return result;
+  }
+
+
+  // --- position masks (precomputed from the tables above) ---
+
+  // All positions of this board.
+  PositionMask getPositionsMask() const { return m_positionsMask; }
+
+  // All neighbors to position p.
+  PositionMask getNeighborMask(Position p) const { return m_neighborMask[p]; }
+
+  // The positions for mill 'i'.
+  PositionMask getMillMask(int i) const { return m_millMask[i]; }
+
+  /* For each mill through position p, the mask of the other positions of that mill.
+     A piece at p is part of a mill if all positions of one of these masks are
+     occupied by the same player. */
+  int                 nMillsThroughPos(Position p) const { return m_nMillsAtPos[p]; }
+  const PositionMask* getMillPartnerMasks(Position p) const { return m_millPartnerMask[p]; }
+
 
   enum BoardPreset
     {
@@ -108,11 +145,33 @@ protected:
   */
   void initPermutations();
 
+  /* This initializes the position masks from the neighbor and mill tables.
+     Call this method once in the constructor.
+  */
+  void initMasks();
+
 private:
   typedef bool UsageVector[MAXPOSITIONS];
   void recursePermutation(Permutation&, UsageVector& used, int pos);
 
   std::vector<Permutation> m_permutations;
+  std::vector<int>         m_inversePermutation;
+
+  // for each permutation: the permuted positions of each value of each byte of a mask
+  struct PermutationTable
+  {
+    PositionMask byteMap[(MAXPOSITIONS+7)/8][256];
+  };
+
+  std::vector<PermutationTable> m_permutationTables;
+
+  PositionMask m_positionsMask;
+  PositionMask m_neighborMask[MAXPOSITIONS];
+  std::vector<PositionMask> m_millMask;
+
+  // one row of 64 bytes (a cache-line) per position
+  PositionMask  m_millPartnerMask[MAXPOSITIONS][MAXMILLSPERPOS] __attribute__((aligned(CACHELINE_SIZE)));
+  unsigned char m_nMillsAtPos[MAXPOSITIONS];
 };
 
 
@@ -28,6 +28,10 @@ const char* ConfigManager::itemComputer_weightMills[2] = { "mills","mills" };
 const char* ConfigManager::itemComputer_weightExperience[2] = { "experience","experience" };
 
 const char* ConfigManager::itemComputers_shareTTables = "share-transposition-tables";
+const char* ConfigManager::itemComputers_ttableSize  = "transposition-table-size";
+const char* ConfigManager::itemComputers_nThreads    = "search-threads";
+const char* ConfigManager::itemComputers_reproducibleParallel = "reproducible-parallel-search";
+const char* ConfigManager::itemComputers_egdbDirectory = "endgame-database-directory";
 
 
 const char* ConfigManager::itemDisplay_showGameOverMessageBox = "show-game-over-message-box";
@@ -79,6 +79,10 @@ public:
   static const char* itemComputer_weightExperience[2];
 
   static const char* itemComputers_shareTTables;
+  static const char* itemComputers_ttableSize;
+  static const char* itemComputers_nThreads;
+  static const char* itemComputers_reproducibleParallel;
+  static const char* itemComputers_egdbDirectory;
 
   static const char* itemDisplay_showGameOverMessageBox;
   static const char* itemDisplayGtk_showCoordinates;
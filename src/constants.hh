@@ -23,8 +23,12 @@ enum { MAXPOSITIONS  =36 };  // maximum number of positions on a board
 enum { MAXPIECES     =15 };  // maximum number of pieces for a player
 enum { MAXNEIGHBORS  =8  };  // maximum number of neighbors of a board position
 enum { MAXMILLSIZE   =3  };  // maximum mill-size
+enum { MAXMILLSPERPOS=8  };  // maximum number of mills through one position
+enum { MAXSYMMETRIES =32 };  // maximum number of symmetries of a board (permutations)
 enum { MAXSEARCHDEPTH=50 };
 
-enum { TRANSPOSITION_TABLE_SIZE=20 }; // significant bits for the transposition-table hash
+enum { CACHELINE_SIZE=64 };  // bytes
+
+enum { DEFAULT_TTABLE_SIZE_MB=32 }; // default memory size of the transposition-table
 
 #endif
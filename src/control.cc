@@ -26,10 +26,6 @@ GameControl::GameControl()
 {
   m_partialMoveActive = false;  // TODO: move the partial moves into board-gui ?
 
-  m_history.push_back( boost::shared_ptr<Board>(new Board) );
-  m_currentHistoryPos=0;
-  m_board=m_history[0].get();
-
   m_moveID=0;
 
   // setup some game ...
@@ -48,7 +44,7 @@ void GameControl::registerPlayerIF(Player p, player_ptr interf)
 
   // if a move is underway, stop it
   if (m_gameState.state == GameState::Moving &&
-      p==m_board->getCurrentPlayer())
+      p==m_record.getCurrentBoard().getCurrentPlayer())
     {
       m_gameState.state = GameState::Idle;
       m_moveID++;
@@ -86,7 +82,7 @@ int GameControl::doMove(Move m)
 
   // check if there are still 'takes' to be added to the move
 
-  int nTakes = m_ruleSpec->nPotentialMills(*m_board, m);
+  int nTakes = m_ruleSpec->nPotentialMills(m_record.getCurrentBoard(), m);
   if (nTakes > 0 && m_ruleSpec->mayTakeMultiple==false)
     nTakes=1;
 
@@ -94,7 +90,7 @@ int GameControl::doMove(Move m)
   if (nTakes>0)
     {
       m_partialMoveActive= true;
-      m_partialMoveBoard = *m_board;
+      m_partialMoveBoard = m_record.getCurrentBoard();
       m_partialMoveBoard.doMove(m);
       m_partialMoveBoard.togglePlayer(); // stay with current player (toggle back)
       return nTakes;
@@ -106,31 +102,20 @@ int GameControl::doMove(Move m)
   m_partialMoveActive=false;
   m_signal_endMove(getCurrentPlayerInterface());
 
-  // add copy of current board to history end
-  m_history.resize(m_currentHistoryPos+1); // delete future history
-  m_movelog.resize(m_currentHistoryPos);   // delete future history
-  m_history.push_back( boost::shared_ptr<Board>(new Board) );
-  m_movelog.push_back(m);
-
-  m_currentHistoryPos++;
-  *(m_history.back()) = *m_board;
-  m_history.back()->setPrevBoard(*(m_history.end()-2));
-  m_board = m_history.back().get();
-
-  m_board->doMove(m);
+  m_record.doMove(m);
 
 
   // check for end of game
 
-  if (m_ruleSpec->currentPlayerHasLost(*m_board))
+  if (m_ruleSpec->currentPlayerHasLost(m_record.getCurrentBoard()))
     {
       m_gameState.state = GameState::Ended;
-      m_gameState.SUBSTATE_Winner = m_board->getOpponentPlayer();
+      m_gameState.SUBSTATE_Winner = m_record.getCurrentBoard().getOpponentPlayer();
     }
   /* We do not have to check for the current player having won,
      because in that case, the opponent would have been detected
      as loser in the previous move. */
-  else if (m_ruleSpec->tieBetweenBothPlayers(*m_board))
+  else if (m_ruleSpec->tieBetweenBothPlayers(m_record.getRepetitions()))
     {
       m_gameState.state = GameState::Ended;
       m_gameState.SUBSTATE_Winner = PL_None;
@@ -149,7 +134,7 @@ int GameControl::doMove(Move m)
       m_winner=m_gameState.SUBSTATE_Winner;
 
       for (int i=0;i<2;i++)
-	{ m_player[i]->notifyWinner(m_winner); }
+	{ m_player[i]->notifyWinner(m_winner, m_record); }
 
       m_signal_gameOver(m_winner);
       m_signal_changeState(m_gameState);
@@ -170,15 +155,15 @@ void GameControl::startNextMove()
 
   // update game state
       
-  const Player p = m_board->getCurrentPlayer();
-  m_gameState.SUBSTATE_PlayerSet  = (m_board->getNPiecesToSet(p) > 0);
-  m_gameState.SUBSTATE_PlayerMove = (m_board->getNPiecesToSet(p)==0 || m_ruleSpec->laskerVariant);
+  const Player p = m_record.getCurrentBoard().getCurrentPlayer();
+  m_gameState.SUBSTATE_PlayerSet  = (m_record.getCurrentBoard().getNPiecesToSet(p) > 0);
+  m_gameState.SUBSTATE_PlayerMove = (m_record.getCurrentBoard().getNPiecesToSet(p)==0 || m_ruleSpec->laskerVariant);
 
 
   // initiate next player's move
 
   m_moveID++;
-  getCurrentPlayerInterface()->startMove(getCurrentBoard(), m_moveID);
+  getCurrentPlayerInterface()->startMove(getCurrentBoard(), m_record.getRepetitions(), m_moveID);
 
   m_signal_startMove( getCurrentPlayerInterface() );
 }
@@ -186,7 +171,7 @@ void GameControl::startNextMove()
 
 void GameControl::undoMove()
 {
-  if (m_currentHistoryPos>0)
+  if (m_record.canUndo())
     {
       m_moveID++;
 
@@ -199,8 +184,7 @@ void GameControl::undoMove()
       m_gameState.state = GameState::Idle;
 
       m_partialMoveActive=false;
-      m_currentHistoryPos--;
-      m_board = m_history[m_currentHistoryPos].get();
+      m_record.undoMove();
 
       m_signal_changeState(m_gameState);
       m_signal_changeBoard();
@@ -210,7 +194,7 @@ void GameControl::undoMove()
 
 void GameControl::redoMove()
 {
-  if (m_currentHistoryPos<m_history.size()-1)
+  if (m_record.canRedo())
     {
       m_moveID++;
 
@@ -221,11 +205,10 @@ void GameControl::redoMove()
 	}
 
       m_partialMoveActive=false;
-      m_currentHistoryPos++;
-      m_board = m_history[m_currentHistoryPos].get();
+      m_record.redoMove();
 
       Player winner;
-      if (m_ruleSpec->isGameOver(*m_board, &winner))
+      if (m_ruleSpec->isGameOver(m_record.getCurrentBoard(), m_record.getRepetitions(), &winner))
 	{
 	  m_gameState.state = GameState::Ended;
 	  m_gameState.SUBSTATE_Winner = winner;
@@ -257,13 +240,9 @@ void GameControl::resetGame()
 
   m_partialMoveActive = false;
 
-  m_history.clear();
-  m_movelog.clear();
-  m_history.push_back( boost::shared_ptr<Board>(new Board) );
-  m_currentHistoryPos=0;
-  m_board = m_history[0].get();
-
-  m_board->reset( m_ruleSpec->nPieces );
+  Board start;
+  start.reset( m_ruleSpec->nPieces );
+  m_record.reset(start);
 
   m_gameHasEnded=false;
   m_gameState.state = GameState::Idle;
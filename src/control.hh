@@ -25,6 +25,7 @@
 
 #include "board.hh"
 #include "player.hh"
+#include "gamerecord.hh"
 
 
 struct GameState
@@ -105,19 +106,19 @@ public:
   /* Force the current player (usually the AI) to carry out the move as
      soon as possible.
    */
-  void forceMove() { m_player[ player2Index(m_board->getCurrentPlayer()) ]->forceMove(); }
+  void forceMove() { m_player[ player2Index(m_record.getCurrentBoard().getCurrentPlayer()) ]->forceMove(); }
 
   GameState     getGameState() const { return m_gameState; }
   Player        getCurrentPlayer() const { return getCurrentBoard().getCurrentPlayer(); }
-  player_ptr    getCurrentPlayerInterface() const { return m_player[player2Index(m_board->getCurrentPlayer())]; }
+  player_ptr    getCurrentPlayerInterface() const { return m_player[player2Index(m_record.getCurrentBoard().getCurrentPlayer())]; }
 
   /* Get the current board. After conducting an incomplete move, this shows the
      situation after the incomplete move. */
-  const Board&  getCurrentBoard() const { return m_partialMoveActive ? m_partialMoveBoard : *m_board; }
+  const Board&  getCurrentBoard() const { return m_partialMoveActive ? m_partialMoveBoard : m_record.getCurrentBoard(); }
 
   /* Same as above, but will never return an intermediate board after a partial move,
      but the situation just before the move. */
-  const Board&  getCurrentBoard_noTemporary() const { return *m_board; }
+  const Board&  getCurrentBoard_noTemporary() const { return m_record.getCurrentBoard(); }
 
   bool          hasGameEnded() const { return m_gameHasEnded; }
   Player        getGameWinner() const { return m_winner; }
@@ -135,15 +136,18 @@ public:
 
 
   // --- history / undo-buffer ---
-  // TODO: extract history to external class (would allow e.g. variation analysis)
 
   void          undoMove();
   void          redoMove();
 
-  int           getHistoryPos() const { return m_currentHistoryPos; }
-  int           getHistorySize() const { return m_history.size(); }
-  Move          getHistoryMove(int ply) const { return m_movelog[ply]; }
-  boost::shared_ptr<Board> getHistoryBoard(int ply) const { return m_history[ply]; }
+  int           getHistoryPos() const { return m_record.getCurrentPly(); }
+  int           getHistorySize() const { return m_record.nMoves()+1; } // number of boards
+  Move          getHistoryMove(int ply) const { return m_record.getMove(ply); }
+
+  const GameRecord& getGameRecord() const { return m_record; }
+
+  // The hashes of the boards up to the current board, for detecting repetitions.
+  const RepetitionStack& getRepetitionHistory() const { return m_record.getRepetitions(); }
 
 
   // --- signals ---
@@ -158,7 +162,6 @@ private:
   rulespec_ptr  m_ruleSpec;
   player_ptr    m_player[2];
 
-  Board*        m_board;
   GameState     m_gameState;
 
   int           m_moveID;
@@ -173,9 +176,7 @@ private:
 
   // Undo-Buffer
 
-  std::vector<Move> m_movelog;
-  std::vector< boost::shared_ptr<Board> > m_history;
-  int m_currentHistoryPos;
+  GameRecord m_record;
 
 
   // signals
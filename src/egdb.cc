@@ -0,0 +1,270 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "egdb.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// --- database files ---
+
+/* The file starts with this header, followed by the values of all positions
+   of the subspace in index order. */
+struct EGDBFileHeader
+{
+  char         magic[8];   // "MORRISDB"
+  unsigned int version;
+  unsigned int rulesChecksum;
+  int          nPositions;
+  int          nMe, nOpp;
+  EGDBIndex    size;
+};
+
+static const char egdbMagic[8] = { 'M','O','R','R','I','S','D','B' };
+static const unsigned int egdbVersion = 1;
+
+
+EndgameDatabase::EndgameDatabase(rulespec_ptr r, const std::string& directory)
+  : m_ruleSpec(r),
+    m_directory(directory)
+{
+  m_checksum = rulesChecksum(*r);
+
+  for (int i=0;i<=MAXPIECES;i++)
+    for (int j=0;j<=MAXPIECES;j++)
+      m_probeTable[i][j] = NULL;
+}
+
+
+EndgameDatabase::~EndgameDatabase()
+{
+  unloadAll();
+}
+
+
+unsigned int EndgameDatabase::rulesChecksum(const RuleSpec& r)
+{
+  const BoardSpec& spec = *r.boardSpec;
+
+  unsigned int sum = 0;
+
+  for (int p=0;p<spec.nPositions();p++)
+    {
+      PositionMask m = spec.getNeighborMask(p);
+      sum = sum*31 + (unsigned int)m;
+      sum = sum*31 + (unsigned int)(m>>32);
+    }
+
+  for (int i=0;i<spec.nMills();i++)
+    {
+      PositionMask m = spec.getMillMask(i);
+      sum = sum*37 + (unsigned int)m;
+      sum = sum*37 + (unsigned int)(m>>32);
+    }
+
+  sum = sum*41 + (r.mayJump                ? 1 : 0);
+  sum = sum*41 + (r.mayTakeMultiple        ? 1 : 0);
+  sum = sum*41 + (r.mayTakeFromMillsAlways ? 1 : 0);
+
+  return sum;
+}
+
+
+std::string EndgameDatabase::fileName(int nMe, int nOpp) const
+{
+  char buf[100];
+  sprintf(buf, "morris-%08x-%d-%d.egdb", m_checksum, nMe, nOpp);
+
+  if (m_directory.empty()) return buf;
+  return m_directory + "/" + buf;
+}
+
+
+bool EndgameDatabase::hasSubspace(int nMe, int nOpp) const
+{
+  if (m_subspaces.find(std::make_pair(nMe,nOpp)) != m_subspaces.end())
+    return true;
+
+  FILE* fh = fopen(fileName(nMe,nOpp).c_str(), "rb");
+  if (fh==NULL)
+    return false;
+
+  fclose(fh);
+  return true;
+}
+
+
+const EGDBValue* EndgameDatabase::getSubspace(int nMe, int nOpp)
+{
+  std::map< std::pair<int,int>, MappedSubspace* >::const_iterator iter;
+  iter = m_subspaces.find(std::make_pair(nMe,nOpp));
+  if (iter != m_subspaces.end())
+    return iter->second->values;
+
+  const std::string name = fileName(nMe,nOpp);
+
+  MappedSubspace* mapped = new MappedSubspace(EGDBSubspace(m_ruleSpec->boardSpec->nPositions(), nMe, nOpp));
+  mapped->length = sizeof(EGDBFileHeader) + mapped->subspace.size();
+
+#ifdef __linux__
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd<0)
+    { delete mapped; return NULL; }
+
+  struct stat st;
+  if (fstat(fd,&st)==0 && st.st_size==off_t(mapped->length))
+    {
+      void* mem = mmap(NULL, mapped->length, PROT_READ, MAP_SHARED, fd, 0);
+      if (mem != MAP_FAILED) mapped->base = mem;
+    }
+
+  close(fd); // the mapping stays valid
+#else
+  FILE* fh = fopen(name.c_str(), "rb");
+  if (fh==NULL)
+    { delete mapped; return NULL; }
+
+  char* mem = new char[mapped->length];
+  if (fread(mem, 1, mapped->length, fh) == mapped->length)
+    { mapped->base = mem; }
+  else
+    { delete[] mem; }
+
+  fclose(fh);
+#endif
+
+  const EGDBFileHeader* header = (const EGDBFileHeader*)mapped->base;
+
+  bool ok = (header != NULL &&
+	     memcmp(header->magic, egdbMagic, sizeof(egdbMagic))==0 &&
+	     header->version       == egdbVersion &&
+	     header->rulesChecksum == m_checksum &&
+	     header->nMe==nMe && header->nOpp==nOpp &&
+	     header->size == mapped->subspace.size());
+
+  if (!ok)
+    {
+      std::cerr << "invalid endgame database file " << name << "\n";
+
+      release(mapped);
+      return NULL;
+    }
+
+  mapped->values = (const EGDBValue*)(header+1);
+
+  m_subspaces[std::make_pair(nMe,nOpp)] = mapped;
+  m_probeTable[nMe][nOpp] = mapped;
+
+  return mapped->values;
+}
+
+
+int EndgameDatabase::mapAvailableSubspaces()
+{
+  const int nPositions = m_ruleSpec->boardSpec->nPositions();
+
+  int n=0;
+  for (int nMe=3;nMe<=MAXPIECES;nMe++)
+    for (int nOpp=3;nOpp<=MAXPIECES && nMe+nOpp<=nPositions;nOpp++)
+      if (hasSubspace(nMe,nOpp) && getSubspace(nMe,nOpp) != NULL)
+	{ n++; }
+
+  return n;
+}
+
+
+bool EndgameDatabase::probe(const Board& b, EGDBValue& value) const
+{
+  assert(egdbCovers(b));
+
+  const int nMe  = b.getNPiecesOnBoard(b.getCurrentPlayer());
+  const int nOpp = b.getNPiecesOnBoard(b.getOpponentPlayer());
+
+  const MappedSubspace* mapped = m_probeTable[nMe][nOpp];
+  if (mapped==NULL)
+    return false;
+
+  value = mapped->values[ mapped->subspace.index(b) ];
+  return true;
+}
+
+
+bool EndgameDatabase::writeSubspace(const EGDBSubspace& subspace, const EGDBValue* values) const
+{
+  EGDBFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, egdbMagic, sizeof(egdbMagic));
+  header.version       = egdbVersion;
+  header.rulesChecksum = m_checksum;
+  header.nPositions    = m_ruleSpec->boardSpec->nPositions();
+  header.nMe           = subspace.nMe();
+  header.nOpp          = subspace.nOpp();
+  header.size          = subspace.size();
+
+  const std::string name = fileName(subspace.nMe(), subspace.nOpp());
+
+  FILE* fh = fopen(name.c_str(), "wb");
+  if (fh==NULL)
+    return false;
+
+  bool ok = (fwrite(&header, sizeof(header), 1, fh)==1 &&
+	     fwrite(values, 1, subspace.size(), fh)==subspace.size());
+
+  if (fclose(fh)!=0) ok=false;
+
+  if (!ok) { remove(name.c_str()); }
+
+  return ok;
+}
+
+
+void EndgameDatabase::release(MappedSubspace* mapped)
+{
+  if (mapped->base != NULL)
+    {
+#ifdef __linux__
+      munmap(mapped->base, mapped->length);
+#else
+      delete[] (char*)mapped->base;
+#endif
+    }
+
+  delete mapped;
+}
+
+
+void EndgameDatabase::unloadAll()
+{
+  std::map< std::pair<int,int>, MappedSubspace* >::iterator iter;
+  for (iter=m_subspaces.begin(); iter!=m_subspaces.end(); iter++)
+    {
+      m_probeTable[iter->first.first][iter->first.second] = NULL;
+      release(iter->second);
+    }
+
+  m_subspaces.clear();
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef EGDB_HH
+#define EGDB_HH
+
+#include "rules.hh"
+#include "boardrank.hh"
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+#include <map>
+
+
+/* Endgame databases for the movement phase, in which both players have set all
+   their pieces.
+
+   The positions are divided into subspaces by the number of pieces of the player to
+   move ('me') and of the opponent ('opp'). The colors do not matter, since the rules
+   are the same for both players.
+
+   Each position is stored as one byte: EGDB_Draw, or one plus the number of plies
+   until the game ends with perfect play from both sides. An odd number of plies is a
+   win for the player to move, an even number a loss.
+ */
+
+typedef unsigned char      EGDBValue;
+typedef BoardIndex         EGDBIndex;
+
+enum { EGDB_Draw=0, EGDB_MaxPlies=254 };
+
+inline EGDBValue egdbValue(int plies) { assert(plies>=0 && plies<=EGDB_MaxPlies); return EGDBValue(plies+1); }
+inline int  egdbPlies (EGDBValue v) { return int(v)-1; }
+inline bool egdbIsWin (EGDBValue v) { return v!=EGDB_Draw && (v&1)==0; }
+inline bool egdbIsLoss(EGDBValue v) { return v!=EGDB_Draw && (v&1)==1; }
+
+// Whether the board is in the movement phase, i.e., it could be stored in an endgame database.
+inline bool egdbCovers(const Board& b)
+{
+  return b.getNPiecesToSet(PL_White)==0 && b.getNPiecesToSet(PL_Black)==0;
+}
+
+
+/* The numbering of the positions in a subspace: the BoardRanking of the pieces of the
+   player to move and of the opponent (without symmetry reduction).
+ */
+class EGDBSubspace
+{
+public:
+  EGDBSubspace(int nPositions, int nMe, int nOpp) : m_ranking(nPositions, nMe, nOpp) { }
+
+  int       nMe()  const { return m_ranking.nWhite(); }
+  int       nOpp() const { return m_ranking.nBlack(); }
+  EGDBIndex size() const { return m_ranking.size(); }
+
+  EGDBIndex index(PositionMask me, PositionMask opp) const { return m_ranking.rank(me,opp); }
+  void      position(EGDBIndex idx, PositionMask& me, PositionMask& opp) const { m_ranking.unrank(idx,me,opp); }
+
+  EGDBIndex index(const Board& b) const { return index(b.getPieces(), b.getOpponentPieces()); }
+
+private:
+  BoardRanking m_ranking;
+};
+
+
+typedef boost::shared_ptr<class EndgameDatabase> egdb_ptr;
+
+/* Access to the endgame-database files of one rule set in a directory.
+   The files are mapped read-only into memory on first access. Hence, the values are
+   only read from disk when they are used, and all processes using the same files
+   share one copy in the page cache.
+ */
+class EndgameDatabase
+{
+public:
+  EndgameDatabase(rulespec_ptr, const std::string& directory);
+  ~EndgameDatabase();
+
+  /* A checksum of the board topology and the rule variants that influence the
+     movement phase. It is stored in the files to detect mismatching rules. */
+  static unsigned int rulesChecksum(const RuleSpec&);
+
+  // Whether the database can be used for these rules.
+  bool matchesRules(const RuleSpec& r) const { return rulesChecksum(r)==m_checksum; }
+
+  std::string fileName(int nMe, int nOpp) const;
+
+  // Whether the subspace file exists (does not load it).
+  bool hasSubspace(int nMe, int nOpp) const;
+
+  /* The values of the subspace, mapped from the file if necessary.
+     Returns NULL if there is no valid file for this subspace. */
+  const EGDBValue* getSubspace(int nMe, int nOpp);
+
+  /* Map all subspaces for which there are files. Returns the number of subspaces.
+     Call this before searching, since probe() only sees the mapped subspaces. */
+  int mapAvailableSubspaces();
+
+  /* Look up the value of a board in the movement phase. Returns false if its
+     subspace is not mapped. This does not modify the database and can be called
+     from several threads concurrently. */
+  bool probe(const Board&, EGDBValue&) const;
+
+  // Write the values of a subspace to its file. Returns false on error.
+  bool writeSubspace(const EGDBSubspace&, const EGDBValue* values) const;
+
+  // Unmap all subspaces.
+  void unloadAll();
+
+private:
+  rulespec_ptr m_ruleSpec;
+  std::string  m_directory;
+  unsigned int m_checksum;
+
+  struct MappedSubspace
+  {
+    MappedSubspace(const EGDBSubspace& s) : subspace(s), base(NULL), length(0), values(NULL) { }
+
+    EGDBSubspace     subspace;
+    void*            base;    // the mapped file
+    size_t           length;
+    const EGDBValue* values;  // behind the file header
+  };
+
+  std::map< std::pair<int,int>, MappedSubspace* > m_subspaces;
+  static void release(MappedSubspace*); // unmap and delete
+
+  // the mapped subspaces, indexed by the piece counts, for fast probing
+  const MappedSubspace* m_probeTable[MAXPIECES+1][MAXPIECES+1];
+};
+
+#endif
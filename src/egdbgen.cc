@@ -0,0 +1,571 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+/* Generator for the endgame databases of the movement phase (see egdb.hh).
+
+   The subspaces are solved by retrograde analysis, in the order of increasing number
+   of pieces. A subspace (a,b) and its counterpart (b,a) are solved together, since
+   the moves without takes lead from one into the other. Moves with takes lead into
+   subspaces with fewer pieces, which are read from the files of the earlier runs.
+
+   The positions are decided ply by ply: the positions that are decided after d plies
+   are predecessors (found with the unmove generator) of positions that were decided
+   after d-1 plies, or positions that have a move with takes into a subspace position
+   that is decided after d-1 plies. Positions that are not decided in the end are draws.
+ */
+
+#include "egdb.hh"
+
+#include <glib.h>
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+class EGDBSolver
+{
+public:
+  EGDBSolver(rulespec_ptr, EndgameDatabase&, int nThreads);
+
+  // Solve the subspaces (a,b) and (b,a) and write them to the database. Returns false on error.
+  bool solve(int a, int b);
+
+private:
+  rulespec_ptr     m_ruleSpec;
+  EndgameDatabase& m_db;
+  int              m_nThreads;
+  int              m_nPositions;
+
+  // a position in one of the two subspaces that are solved together
+  struct PosRef
+  {
+    int       sub;
+    EGDBIndex index;
+  };
+
+  int m_nSubspaces;  // 1 if both subspaces are the same (a==b)
+  std::vector<EGDBSubspace> m_subspace;
+  std::vector<EGDBValue>    m_values[2];
+  std::vector<bool>         m_marked[2];  // already in the candidate list of the current ply
+
+  // subspaces with fewer pieces, indexed by the number of pieces of the player to move
+  const EGDBValue* m_smaller[2][MAXPIECES+1];
+
+  int partner(int sub) const { return m_nSubspaces==1 ? 0 : 1-sub; }
+
+  void setupBoard(int sub, EGDBIndex, Board&) const;
+  EGDBValue successorValue(int sub, const Board& afterMove) const;
+  EGDBValue evaluate(int sub, EGDBIndex, Board&, std::vector<Move>&) const;
+  void addPredecessors(const PosRef&, std::vector<PosRef>& candidates, Board&);
+
+
+  // --- work distribution ---
+
+  std::vector<PosRef>    m_candidates;
+  std::vector<EGDBValue> m_candidateValues;
+
+  int m_initSub;
+  std::vector< std::vector< std::pair<int,PosRef> > > m_threadTriggers; // [thread][] (ply, position)
+
+  void initRange(int thread);
+  void evaluateCandidates(int thread);
+
+  void runParallel(void (EGDBSolver::*)(int thread));
+
+  struct WorkerTask
+  {
+    EGDBSolver* solver;
+    void (EGDBSolver::*function)(int thread);
+    int thread;
+  };
+
+  static gpointer runWorker(gpointer);
+
+  void threadRange(int thread, EGDBIndex n, EGDBIndex& begin, EGDBIndex& end) const
+  {
+    begin = n* thread   /m_nThreads;
+    end   = n*(thread+1)/m_nThreads;
+  }
+};
+
+
+EGDBSolver::EGDBSolver(rulespec_ptr r, EndgameDatabase& db, int nThreads)
+  : m_ruleSpec(r),
+    m_db(db),
+    m_nThreads(nThreads)
+{
+  m_nPositions = r->boardSpec->nPositions();
+}
+
+
+void EGDBSolver::setupBoard(int sub, EGDBIndex idx, Board& board) const
+{
+  PositionMask me, opp;
+  m_subspace[sub].position(idx, me, opp);
+
+  board.setPieces(me, opp, PL_White);
+}
+
+
+/* The value of the position after a move, from the view of the player to move there. */
+EGDBValue EGDBSolver::successorValue(int sub, const Board& afterMove) const
+{
+  const int nMe = afterMove.getNPiecesOnBoard();
+
+  if (nMe<3) { return egdbValue(0); }
+
+  if (nMe == m_subspace[sub].nOpp())
+    {
+      const int p = partner(sub);
+      return m_values[p][ m_subspace[p].index(afterMove) ];
+    }
+
+  const EGDBSubspace smaller(m_nPositions, nMe, m_subspace[sub].nMe());
+  return m_smaller[sub][nMe][ smaller.index(afterMove) ];
+}
+
+
+/* Decide the position from the values of its successors that are known up to now.
+   Returns EGDB_Draw if it cannot be decided yet. */
+EGDBValue EGDBSolver::evaluate(int sub, EGDBIndex idx, Board& board, std::vector<Move>& moves) const
+{
+  setupBoard(sub, idx, board);
+
+  moves.clear();
+  m_ruleSpec->generateMoves(moves, board);
+
+  if (moves.empty()) { return egdbValue(0); }
+
+  int  fastestWin = -1;
+  int  slowestLoss = 0;
+  bool allLost = true;
+
+  for (size_t i=0;i<moves.size();i++)
+    {
+      board.doMove(moves[i]);
+      EGDBValue v = successorValue(sub, board);
+      board.undoMove(moves[i]);
+
+      if (egdbIsLoss(v))
+	{
+	  const int plies = egdbPlies(v)+1;
+	  if (fastestWin<0 || plies<fastestWin) fastestWin=plies;
+	  allLost=false;
+	}
+      else if (egdbIsWin(v))
+	{
+	  slowestLoss = std::max(slowestLoss, egdbPlies(v)+1);
+	}
+      else
+	{
+	  allLost=false;
+	}
+    }
+
+  if (fastestWin>=0) { return egdbValue(fastestWin); }
+  if (allLost)       { return egdbValue(slowestLoss); }
+
+  return EGDB_Draw;
+}
+
+
+/* Add the undecided predecessors of the position to the candidates. These are the
+   positions in the partner subspace from which the opponent moved into the position,
+   without closing a mill.
+ */
+void EGDBSolver::addPredecessors(const PosRef& pos, std::vector<PosRef>& candidates, Board& board)
+{
+  const BoardSpec& spec = *m_ruleSpec->boardSpec;
+
+  PositionMask me, opp;
+  m_subspace[pos.sub].position(pos.index, me, opp);
+
+  const PositionMask empty = spec.getPositionsMask() & ~(me|opp);
+  const bool oppJumps = (m_ruleSpec->mayJump && nPositionsInMask(opp)==3);
+
+  const int p = partner(pos.sub);
+
+  for (PositionMask m=opp; m; m&=m-1)
+    {
+      const Position to = firstPositionInMask(m);
+
+      PositionMask sources = empty;
+      if (!oppJumps) { sources &= spec.getNeighborMask(to); }
+
+      for (PositionMask s=sources; s; s&=s-1)
+	{
+	  const Position from = firstPositionInMask(s);
+	  const PositionMask predOpp = (opp & ~positionBit(to)) | positionBit(from);
+
+	  const EGDBIndex idx = m_subspace[p].index(predOpp, me);
+	  if (m_values[p][idx] != EGDB_Draw || m_marked[p][idx])
+	    continue;
+
+	  // a move that closes a mill would have taken a piece
+
+	  Move move;
+	  move.setMove_Move(from, to);
+	  board.setPieces(predOpp, me, PL_White);
+	  if (m_ruleSpec->nPotentialMills(board, move)>0)
+	    continue;
+
+	  m_marked[p][idx] = true;
+
+	  PosRef pred;
+	  pred.sub   = p;
+	  pred.index = idx;
+	  candidates.push_back(pred);
+	}
+    }
+}
+
+
+/* Initial pass: positions without moves are lost immediately. Positions with moves into
+   the smaller subspaces are triggered at the ply after the successor's decision. */
+void EGDBSolver::initRange(int thread)
+{
+  const int sub = m_initSub;
+
+  EGDBIndex begin, end;
+  threadRange(thread, m_subspace[sub].size(), begin, end);
+
+  Board board;
+  std::vector<Move> moves;
+
+  std::vector< std::pair<int,PosRef> >& triggers = m_threadTriggers[thread];
+
+  for (EGDBIndex idx=begin; idx<end; idx++)
+    {
+      setupBoard(sub, idx, board);
+
+      moves.clear();
+      m_ruleSpec->generateMoves(moves, board);
+
+      PosRef pos;
+      pos.sub   = sub;
+      pos.index = idx;
+
+      if (moves.empty())
+	{
+	  triggers.push_back(std::make_pair(0, pos));
+	  continue;
+	}
+
+      int fastestWin  = -1;
+      int slowestLoss = -1;
+
+      for (size_t i=0;i<moves.size();i++)
+	{
+	  if (moves[i].takes.size()==0)
+	    continue;
+
+	  board.doMove(moves[i]);
+	  EGDBValue v = successorValue(sub, board);
+	  board.undoMove(moves[i]);
+
+	  const int plies = egdbPlies(v)+1;
+
+	  if      (egdbIsLoss(v)) { if (fastestWin<0 || plies<fastestWin) fastestWin=plies; }
+	  else if (egdbIsWin(v))  { slowestLoss = std::max(slowestLoss, plies); }
+	}
+
+      if (fastestWin >=0) { triggers.push_back(std::make_pair(fastestWin,  pos)); }
+      if (slowestLoss>=0) { triggers.push_back(std::make_pair(slowestLoss, pos)); }
+    }
+}
+
+
+void EGDBSolver::evaluateCandidates(int thread)
+{
+  EGDBIndex begin, end;
+  threadRange(thread, m_candidates.size(), begin, end);
+
+  Board board;
+  std::vector<Move> moves;
+
+  for (EGDBIndex i=begin; i<end; i++)
+    {
+      m_candidateValues[i] = evaluate(m_candidates[i].sub, m_candidates[i].index, board, moves);
+    }
+}
+
+
+gpointer EGDBSolver::runWorker(gpointer data)
+{
+  WorkerTask* task = (WorkerTask*)data;
+  (task->solver->*(task->function))(task->thread);
+  return NULL;
+}
+
+
+void EGDBSolver::runParallel(void (EGDBSolver::*function)(int thread))
+{
+  std::vector<WorkerTask> tasks(m_nThreads);
+  std::vector<GThread*>   threads;
+
+  for (int i=1;i<m_nThreads;i++)
+    {
+      tasks[i].solver   = this;
+      tasks[i].function = function;
+      tasks[i].thread   = i;
+
+      threads.push_back( g_thread_new(NULL, runWorker, &tasks[i]) );
+    }
+
+  (this->*function)(0);
+
+  for (size_t i=0;i<threads.size();i++)
+    g_thread_join(threads[i]);
+}
+
+
+bool EGDBSolver::solve(int a, int b)
+{
+  m_nSubspaces = (a==b ? 1 : 2);
+
+  m_subspace.clear();
+  m_subspace.push_back(EGDBSubspace(m_nPositions, a, b));
+  m_subspace.push_back(EGDBSubspace(m_nPositions, b, a));
+
+  // load the subspaces that are reached with takes
+
+  for (int sub=0;sub<m_nSubspaces;sub++)
+    {
+      const int nMe  = m_subspace[sub].nMe();
+      const int nOpp = m_subspace[sub].nOpp();
+
+      for (int n=0;n<=MAXPIECES;n++)
+	{
+	  m_smaller[sub][n] = NULL;
+
+	  if (n>=3 && n<nOpp)
+	    {
+	      m_smaller[sub][n] = m_db.getSubspace(n, nMe);
+	      if (m_smaller[sub][n]==NULL)
+		{
+		  std::cerr << "missing endgame database for " << n << "-" << nMe << "\n";
+		  return false;
+		}
+	    }
+	}
+    }
+
+  for (int sub=0;sub<m_nSubspaces;sub++)
+    {
+      m_values[sub].assign(m_subspace[sub].size(), EGDB_Draw);
+      m_marked[sub].assign(m_subspace[sub].size(), false);
+    }
+
+
+  // initial pass, sort the triggered positions by the ply of their decision
+
+  std::vector< std::vector<PosRef> > triggered(EGDB_MaxPlies+2);
+
+  for (int sub=0;sub<m_nSubspaces;sub++)
+    {
+      m_initSub = sub;
+      m_threadTriggers.assign(m_nThreads, std::vector< std::pair<int,PosRef> >());
+
+      runParallel(&EGDBSolver::initRange);
+
+      for (int t=0;t<m_nThreads;t++)
+	for (size_t i=0;i<m_threadTriggers[t].size();i++)
+	  {
+	    const int ply = m_threadTriggers[t][i].first;
+	    if (ply > EGDB_MaxPlies)
+	      {
+		std::cerr << "game length exceeds the endgame database format\n";
+		return false;
+	      }
+
+	    triggered[ply].push_back(m_threadTriggers[t][i].second);
+	  }
+
+      m_threadTriggers.clear();
+    }
+
+
+  // decide the positions ply by ply
+
+  std::vector<PosRef> decided;  // positions decided in the previous ply
+  Board board;
+
+  for (int ply=0; ply<=EGDB_MaxPlies; ply++)
+    {
+      m_candidates.clear();
+
+      for (size_t i=0;i<triggered[ply].size();i++)
+	{
+	  const PosRef& pos = triggered[ply][i];
+	  if (m_values[pos.sub][pos.index] == EGDB_Draw && !m_marked[pos.sub][pos.index])
+	    {
+	      m_marked[pos.sub][pos.index] = true;
+	      m_candidates.push_back(pos);
+	    }
+	}
+
+      std::vector<PosRef>().swap(triggered[ply]);
+
+      for (size_t i=0;i<decided.size();i++)
+	addPredecessors(decided[i], m_candidates, board);
+
+      // evaluate all candidates in parallel, the new values are only stored afterwards
+
+      m_candidateValues.assign(m_candidates.size(), EGDB_Draw);
+      runParallel(&EGDBSolver::evaluateCandidates);
+
+      decided.clear();
+
+      for (size_t i=0;i<m_candidates.size();i++)
+	{
+	  const PosRef& pos = m_candidates[i];
+	  m_marked[pos.sub][pos.index] = false;
+
+	  // not decided in this ply (it is triggered again later)
+	  if (m_candidateValues[i] == EGDB_Draw ||
+	      egdbPlies(m_candidateValues[i]) != ply)
+	    continue;
+
+	  m_values[pos.sub][pos.index] = m_candidateValues[i];
+	  decided.push_back(pos);
+	}
+
+      if (decided.empty())
+	{
+	  bool pending=false;
+	  for (int p=ply+1;p<=EGDB_MaxPlies;p++)
+	    if (!triggered[p].empty()) { pending=true; break; }
+
+	  if (!pending) break;
+	}
+      else if (ply==EGDB_MaxPlies)
+	{
+	  std::cerr << "game length exceeds the endgame database format\n";
+	  return false;
+	}
+    }
+
+
+  // statistics and output
+
+  for (int sub=0;sub<m_nSubspaces;sub++)
+    {
+      EGDBIndex nWins=0, nLosses=0, nDraws=0;
+      int maxPlies=0;
+
+      for (EGDBIndex i=0;i<m_values[sub].size();i++)
+	{
+	  const EGDBValue v = m_values[sub][i];
+
+	  if      (egdbIsWin(v))  nWins++;
+	  else if (egdbIsLoss(v)) nLosses++;
+	  else                    nDraws++;
+
+	  if (v != EGDB_Draw) maxPlies = std::max(maxPlies, egdbPlies(v));
+	}
+
+      std::cout << m_subspace[sub].nMe() << "-" << m_subspace[sub].nOpp() << ": "
+		<< m_values[sub].size() << " positions, "
+		<< nWins << " won, " << nLosses << " lost, " << nDraws << " drawn, "
+		<< "longest game " << maxPlies << " plies\n";
+
+      if (!m_db.writeSubspace(m_subspace[sub], &m_values[sub][0]))
+	{
+	  std::cerr << "cannot write " << m_db.fileName(m_subspace[sub].nMe(), m_subspace[sub].nOpp()) << "\n";
+	  return false;
+	}
+    }
+
+  for (int sub=0;sub<2;sub++)
+    {
+      std::vector<EGDBValue>().swap(m_values[sub]);
+      std::vector<bool>().swap(m_marked[sub]);
+    }
+
+  m_db.unloadAll();
+
+  return true;
+}
+
+
+// ----------------------------------------------------------------------------------------------------
+
+static void usage()
+{
+  std::cerr << "usage: morris-egdbgen [--threads=N] [--dir=DIRECTORY] RULES MAXPIECES\n"
+	    << "Solves the movement phase for up to MAXPIECES pieces per player.\n"
+	    << "RULES is one of:";
+
+  for (int i=0;RuleSpec::presetNames[i].name;i++)
+    std::cerr << " " << RuleSpec::presetNames[i].name;
+
+  std::cerr << "\n";
+}
+
+
+int main(int argc, char** argv)
+{
+  int         nThreads = 1;
+  std::string directory = ".";
+
+  std::vector<const char*> args;
+
+  for (int i=1;i<argc;i++)
+    {
+      /**/ if (strncmp(argv[i], "--threads=", 10)==0) { nThreads  = atoi(argv[i]+10); }
+      else if (strncmp(argv[i], "--dir=", 6)==0)      { directory = argv[i]+6; }
+      else if (argv[i][0]=='-')                       { usage(); return 5; }
+      else                                            { args.push_back(argv[i]); }
+    }
+
+  if (args.size()!=2 || nThreads<1) { usage(); return 5; }
+
+  rulespec_ptr rules = RuleSpec::createPresetRule(args[0]);
+  if (rules==NULL) { usage(); return 5; }
+
+  Board::initHashValues();
+
+  const int nPositions = rules->boardSpec->nPositions();
+  const int maxPieces  = std::min(atoi(args[1]), rules->nPieces);
+
+  EndgameDatabase db(rules, directory);
+  EGDBSolver solver(rules, db, nThreads);
+
+  // solve by increasing total number of pieces, each pair of subspaces only once
+
+  for (int total=6; total<=2*maxPieces && total<=nPositions; total++)
+    for (int a=3; a<=total-a; a++)
+      {
+	const int b = total-a;
+	if (b>maxPieces) continue;
+
+	if (db.hasSubspace(a,b) && db.hasSubspace(b,a))
+	  continue;
+
+	const time_t start = time(NULL);
+
+	if (!solver.solve(a,b))
+	  return 10;
+
+	std::cout << "  (" << time(NULL)-start << " seconds)\n";
+      }
+
+  return 0;
+}
@@ -0,0 +1,551 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+/* morris-engine: the computer player without the GUI, for running on servers or for
+   connecting it to other front-ends. The engine reads commands from stdin and writes
+   its replies to stdout, one per line. The protocol is modeled after UCI:
+
+     uci                  -> "id ..." lines, followed by "uciok"
+     isready              -> "readyok"
+     setoption name NAME value V
+                          Threads (1..64), ParallelMode (SharedTT or SplitPoints),
+                          PVS, Aspiration, Quiescence, NullMove, LMR, SymmetricHashing
+                          (true or false)
+     rules NAME           select a rules preset ("standard", "6mm", ...) and start a new game
+     newgame              start a new game (and clear the transposition table)
+     position startpos [moves M1 M2 ...]
+     position fen BOARD SIDE WTOSET BTOSET [moves M1 M2 ...]
+                          start from the given board: BOARD has one character per board
+                          position ('w', 'b', or '.' for empty) in the order of the position
+                          numbers, i.e. row by row from "a1" on the standard boards, with
+                          optional '/' for readability. SIDE is 'w' or 'b' for the player
+                          to move, WTOSET and BTOSET are the numbers of pieces each player
+                          still has to set. The game history before this board is unknown.
+     go [depth D] [movetime MS] [nodes N] [infinite]
+                          -> "info depth D score cp E nodes N nps N time MS pv M1 M2 ..."
+                             after each iteration ("score mate N" for a forced win or loss),
+                             followed by "bestmove M". Without limits, the engine thinks
+                             until "stop".
+     stop                 move as soon as possible
+     quit                 exit at once, the move of a running search is not sent
+
+   At the end of the input, the engine waits until a running search is finished and sends
+   its move, such that piped commands ("position ..." and "go depth 6") give a move.
+   A search without limits is stopped first.
+
+   Moves are written as in the move log: "d2" sets a piece, "d2-d3" moves a piece, and
+   "xa1" is appended for each piece taken.
+ */
+
+#include "config.h"
+#include "algo_alphabeta.hh"
+#include "rules.hh"
+#include "gamerecord.hh"
+#include "egdb.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <glib.h>
+
+
+// --- output ---
+
+static GMutex outputMutex; // the search thread sends its results concurrently to the command loop
+
+static void sendLine(const std::string& line)
+{
+  g_mutex_lock(&outputMutex);
+  std::cout << line << std::endl;
+  g_mutex_unlock(&outputMutex);
+}
+
+
+static void sendCheckOption(const char* name, bool value)
+{
+  sendLine(std::string("option name ") + name + " type check default " + (value ? "true" : "false"));
+}
+
+
+// --- search output ---
+
+class EngineObserver : public SearchObserver
+{
+public:
+  void setRuleSpec(rulespec_ptr r) { m_ruleSpec=r; }
+
+  void showSearchInfo(const SearchInfo& info)
+  {
+    std::stringstream str;
+
+    str << "info depth " << info.depth;
+
+    if (info.winInMoves != 0) { str << " score mate " << info.winInMoves; }
+    else                      { str << " score cp "   << info.eval; }
+
+    str << " nodes " << info.nodes
+	<< " nps "   << info.nodes*1000 / std::max(info.msecs,1)
+	<< " time "  << info.msecs;
+
+    if (!info.pv.empty())
+      {
+	str << " pv";
+	for (size_t i=0;i<info.pv.size();i++)
+	  str << " " << writeMove(info.pv[i], m_ruleSpec->boardSpec);
+      }
+
+    sendLine(str.str());
+  }
+
+private:
+  rulespec_ptr m_ruleSpec;
+};
+
+
+// --- engine ---
+
+class Engine
+{
+public:
+  Engine(int ttableSizeMB, const std::string& egdbDirectory);
+  ~Engine();
+
+  // Process commands until "quit" or the end of the input.
+  void run();
+
+private:
+  rulespec_ptr    m_ruleSpec;
+  GameRecord      m_game;
+  ttable_ptr      m_ttable;
+  std::string     m_egdbDirectory;
+  AlphaBetaSearch m_search;
+  EngineObserver  m_observer;
+
+  // the search runs in its own thread, such that the commands are still read
+  AlphaBetaSearch::SearchLimits m_limits;
+  GThread*        m_searchThread;
+  volatile bool   m_ignoreMove;
+  bool            m_infinite;   // the running search only ends with "stop"
+
+  friend void startSearchThread(Engine*);
+  void runSearch();
+  void stopSearch(bool sendMove=false); // stop a running search, only send its move if 'sendMove'
+  void finishSearch(); // wait for a running search (stop it if infinite) and send its move
+
+  void setRules(rulespec_ptr);
+  void newGame();
+  bool setPosition(std::istream& args);
+  void go(std::istream& args);
+  void setOption(std::istream& args);
+
+  bool parseMove(const std::string&, const Board&, Move&) const;
+  bool parseBoard(std::istream& args, Board&) const;
+};
+
+
+Engine::Engine(int ttableSizeMB, const std::string& egdbDirectory)
+  : m_ttable(new TranspositionTable(ttableSizeMB)),
+    m_egdbDirectory(egdbDirectory),
+    m_searchThread(NULL),
+    m_ignoreMove(false),
+    m_infinite(false)
+{
+  m_search.registerTTable(m_ttable);
+  m_search.registerObserver(&m_observer);
+
+  setRules(RuleSpec::createPresetRule(RuleSpec::Preset_Standard));
+}
+
+
+Engine::~Engine()
+{
+  stopSearch();
+}
+
+
+// kicker
+void startSearchThread(Engine* engine)
+{
+  engine->runSearch();
+}
+
+
+void Engine::runSearch()
+{
+  AlphaBetaSearch::SearchResult result = m_search.search(m_game.getCurrentBoard(),
+							 m_game.getRepetitions(), m_limits);
+
+  if (!m_ignoreMove)
+    { sendLine("bestmove " + writeMove(result.move, m_ruleSpec->boardSpec)); }
+}
+
+
+void Engine::stopSearch(bool sendMove)
+{
+  if (m_searchThread)
+    {
+      if (!sendMove) { m_ignoreMove=true; }
+      m_search.stop();
+
+      g_thread_join(m_searchThread);
+      m_searchThread=NULL;
+    }
+}
+
+
+void Engine::finishSearch()
+{
+  if (m_infinite)
+    {
+      stopSearch(true);
+    }
+  else if (m_searchThread)
+    {
+      g_thread_join(m_searchThread);
+      m_searchThread=NULL;
+    }
+}
+
+
+void Engine::setRules(rulespec_ptr r)
+{
+  m_ruleSpec = r;
+
+  m_observer.setRuleSpec(r);
+  m_search.setRuleSpec(r);
+
+  egdb_ptr egdb;
+  if (!m_egdbDirectory.empty())
+    {
+      egdb = egdb_ptr(new EndgameDatabase(r, m_egdbDirectory));
+
+      if (egdb->mapAvailableSubspaces()==0)
+	{ egdb.reset(); }
+    }
+
+  m_search.registerEndgameDatabase(egdb);
+
+  newGame();
+}
+
+
+void Engine::newGame()
+{
+  Board start;
+  start.reset(m_ruleSpec->nPieces);
+  m_game.reset(start);
+
+  m_search.resetGame();
+}
+
+
+bool Engine::parseMove(const std::string& str, const Board& board, Move& move) const
+{
+  std::vector<Move> moves;
+  m_ruleSpec->generateMoves(moves, board);
+
+  for (size_t i=0;i<moves.size();i++)
+    if (writeMove(moves[i], m_ruleSpec->boardSpec) == str)
+      {
+	move = moves[i];
+	return true;
+      }
+
+  return false;
+}
+
+
+bool Engine::parseBoard(std::istream& args, Board& board) const
+{
+  std::string pieces, side;
+  int nWhiteToSet=-1, nBlackToSet=-1;
+
+  args >> pieces >> side >> nWhiteToSet >> nBlackToSet;
+
+  PositionMask white=0, black=0;
+  int p=0;
+  for (size_t i=0;i<pieces.size();i++)
+    {
+      const char c = pieces[i];
+      if (c=='/') { continue; }
+
+      if (p == m_ruleSpec->boardSpec->nPositions()) { return false; }
+
+      /**/ if (c=='w') { white |= positionBit(p); }
+      else if (c=='b') { black |= positionBit(p); }
+      else if (c!='.') { return false; }
+
+      p++;
+    }
+
+  if (p != m_ruleSpec->boardSpec->nPositions()) { return false; }
+  if (side != "w" && side != "b")               { return false; }
+
+  if (nWhiteToSet<0 || nWhiteToSet + nPositionsInMask(white) > m_ruleSpec->nPieces ||
+      nBlackToSet<0 || nBlackToSet + nPositionsInMask(black) > m_ruleSpec->nPieces)
+    { return false; }
+
+  board.setPieces(white, black, side=="w" ? PL_White : PL_Black, nWhiteToSet, nBlackToSet);
+  return true;
+}
+
+
+bool Engine::setPosition(std::istream& args)
+{
+  std::string token;
+  args >> token;
+
+  Board start;
+
+  if (token == "startpos")
+    {
+      start.reset(m_ruleSpec->nPieces);
+    }
+  else if (token == "fen")
+    {
+      if (!parseBoard(args, start))
+	{
+	  sendLine("info string invalid board");
+	  return false;
+	}
+    }
+  else
+    {
+      sendLine("info string unknown position type '" + token + "'");
+      return false;
+    }
+
+  GameRecord game;
+  game.reset(start);
+
+  if (args >> token)
+    {
+      if (token != "moves")
+	return false;
+
+      while (args >> token)
+	{
+	  Move m;
+	  if (!parseMove(token, game.getCurrentBoard(), m))
+	    {
+	      sendLine("info string invalid move '" + token + "'");
+	      return false;
+	    }
+
+	  game.doMove(m);
+	}
+    }
+
+  m_game = game;
+  return true;
+}
+
+
+void Engine::go(std::istream& args)
+{
+  int  depth = MAXSEARCHDEPTH;
+  int  msecs = INT_MAX;
+  long nodes = 0;
+  bool limited  = false;
+  bool infinite = false;
+
+  std::string token;
+  while (args >> token)
+    {
+      /**/ if (token=="depth")    { args >> depth; limited=true; }
+      else if (token=="movetime") { args >> msecs; limited=true; }
+      else if (token=="nodes")    { args >> nodes; limited=true; }
+      else if (token=="infinite") { infinite=true; }
+    }
+
+  depth = std::max(1, std::min(depth, int(MAXSEARCHDEPTH)));
+
+  const Board& board = m_game.getCurrentBoard();
+
+  if (m_ruleSpec->isGameOver(board, m_game.getRepetitions()))
+    {
+      sendLine("bestmove (none)");
+      return;
+    }
+
+  m_limits.maxDepth = depth;
+  m_limits.maxMSecs = msecs;
+  m_limits.maxNodes = nodes;
+
+  m_infinite   = (infinite || !limited);
+  m_ignoreMove = false;
+  m_search.clearStop();
+  m_searchThread = g_thread_new(NULL, (GThreadFunc)startSearchThread, this);
+}
+
+
+void Engine::setOption(std::istream& args)
+{
+  std::string token, name, value;
+
+  args >> token; // "name"
+  args >> name;
+  args >> token; // "value"
+  args >> value;
+
+  const bool flag = (value=="true");
+
+  /**/ if (name=="Threads")
+    {
+      int n = atoi(value.c_str());
+      if (n>=1) m_search.setNThreads(n);
+    }
+  else if (name=="ParallelMode")
+    {
+      /**/ if (value=="SharedTT")    { m_search.setParallelMode(AlphaBetaSearch::Parallel_SharedTT); }
+      else if (value=="SplitPoints") { m_search.setParallelMode(AlphaBetaSearch::Parallel_SplitPoints); }
+      else { sendLine("info string unknown parallel mode '" + value + "'"); }
+    }
+  else if (name=="PVS")              { m_search.setUsePVS(flag); }
+  else if (name=="Aspiration")       { m_search.setUseAspirationWindows(flag); }
+  else if (name=="Quiescence")       { m_search.setUseQuiescence(flag); }
+  else if (name=="NullMove")         { m_search.setUseNullMove(flag); }
+  else if (name=="LMR")              { m_search.setUseLateMoveReductions(flag); }
+  else if (name=="SymmetricHashing") { m_search.setUseSymmetricHashing(flag); }
+  else
+    {
+      sendLine("info string unknown option '" + name + "'");
+    }
+}
+
+
+void Engine::run()
+{
+  std::string line;
+
+  while (std::getline(std::cin, line))
+    {
+      std::istringstream args(line);
+      std::string cmd;
+      if (!(args >> cmd))
+	continue;
+
+      /**/ if (cmd=="uci")
+	{
+	  sendLine("id name Morris " VERSION);
+	  sendLine("id author Dirk Farin");
+	  sendLine("option name Threads type spin default 1 min 1 max 64");
+	  sendLine(std::string("option name ParallelMode type combo default ") +
+		   (m_search.askParallelMode()==AlphaBetaSearch::Parallel_SplitPoints ?
+		    "SplitPoints" : "SharedTT") + " var SharedTT var SplitPoints");
+	  sendCheckOption("PVS",              m_search.askUsePVS());
+	  sendCheckOption("Aspiration",       m_search.askUseAspirationWindows());
+	  sendCheckOption("Quiescence",       m_search.askUseQuiescence());
+	  sendCheckOption("NullMove",         m_search.askUseNullMove());
+	  sendCheckOption("LMR",              m_search.askUseLateMoveReductions());
+	  sendCheckOption("SymmetricHashing", m_search.askUseSymmetricHashing());
+	  sendLine("uciok");
+	}
+      else if (cmd=="isready")
+	{
+	  sendLine("readyok");
+	}
+      else if (cmd=="setoption")
+	{
+	  stopSearch();
+	  setOption(args);
+	}
+      else if (cmd=="rules")
+	{
+	  std::string name;
+	  args >> name;
+
+	  rulespec_ptr r = RuleSpec::createPresetRule(name.c_str());
+	  if (r==NULL)
+	    { sendLine("info string unknown rules '" + name + "'"); }
+	  else
+	    {
+	      stopSearch();
+	      setRules(r);
+	    }
+	}
+      else if (cmd=="newgame" || cmd=="ucinewgame")
+	{
+	  stopSearch();
+	  newGame();
+	}
+      else if (cmd=="position")
+	{
+	  stopSearch();
+	  setPosition(args);
+	}
+      else if (cmd=="go")
+	{
+	  stopSearch();
+	  go(args);
+	}
+      else if (cmd=="stop")
+	{
+	  stopSearch(true);
+	}
+      else if (cmd=="quit")
+	{
+	  stopSearch();
+	  return;
+	}
+      else
+	{
+	  sendLine("info string unknown command '" + cmd + "'");
+	}
+    }
+
+  // end of the input
+  finishSearch();
+}
+
+
+static void usage()
+{
+  std::cerr << "usage: morris-engine [--ttable-size=MB] [--egdb-dir=DIRECTORY]\n"
+	    << "Reads commands from stdin (see engine.cc for the protocol).\n";
+}
+
+
+int main(int argc, char** argv)
+{
+  int         ttableSizeMB = DEFAULT_TTABLE_SIZE_MB;
+  std::string egdbDirectory;
+
+  for (int i=1;i<argc;i++)
+    {
+      /**/ if (strncmp(argv[i], "--ttable-size=", 14)==0) { ttableSizeMB  = atoi(argv[i]+14); }
+      else if (strncmp(argv[i], "--egdb-dir=", 11)==0)    { egdbDirectory = argv[i]+11; }
+      else                                                { usage(); return 5; }
+    }
+
+  if (ttableSizeMB<1) { usage(); return 5; }
+
+  srand(time(NULL));
+  Board::initHashValues();
+
+  Engine engine(ttableSizeMB, egdbDirectory);
+  engine.run();
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "gamerecord.hh"
+
+
+GameRecord::GameRecord()
+{
+  m_currentPly=0;
+}
+
+
+void GameRecord::reset(const Board& start)
+{
+  m_startBoard   = start;
+  m_currentBoard = start;
+  m_currentPly   = 0;
+
+  m_moves.clear();
+
+  m_repetitions.clear();
+  m_repetitions.push(m_currentBoard);
+}
+
+
+void GameRecord::doMove(const Move& m)
+{
+  m_moves.resize(m_currentPly); // delete future history
+  m_moves.push_back(m);
+
+  redoMove();
+}
+
+
+void GameRecord::undoMove()
+{
+  assert(canUndo());
+
+  m_currentPly--;
+  m_currentBoard.undoMove(m_moves[m_currentPly]);
+  m_repetitions.pop();
+}
+
+
+void GameRecord::redoMove()
+{
+  assert(canRedo());
+
+  m_currentBoard.doMove(m_moves[m_currentPly]);
+  m_currentPly++;
+  m_repetitions.push(m_currentBoard);
+}
+
+
+Board GameRecord::getBoard(int ply) const
+{
+  assert(ply>=0 && ply<=nMoves());
+
+  if (ply==m_currentPly)
+    return m_currentBoard;
+
+  Board b = m_startBoard;
+  for (int i=0;i<ply;i++)
+    b.doMove(m_moves[i]);
+
+  return b;
+}
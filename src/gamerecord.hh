@@ -0,0 +1,72 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef GAMERECORD_HH
+#define GAMERECORD_HH
+
+#include "board.hh"
+#include "repetition.hh"
+#include <vector>
+
+
+/* The moves of a game, starting from its initial board. The record has a current position,
+   which can be moved back and forth through the game (undo/redo).
+
+   Only the initial and the current board are stored. The other boards of the game are
+   obtained by replaying the moves. The hashes of the boards up to the current position
+   are kept in a RepetitionStack, for detecting ties.
+ */
+class GameRecord
+{
+public:
+  GameRecord();
+
+  // Start a new game.
+  void reset(const Board& start);
+
+  // Carry out a move at the current position. The moves that could be redone are discarded.
+  void doMove(const Move&);
+
+  bool canUndo() const { return m_currentPly>0; }
+  bool canRedo() const { return m_currentPly<nMoves(); }
+  void undoMove();
+  void redoMove();
+
+  int   nMoves() const { return m_moves.size(); } // including the moves that can be redone
+  int   getCurrentPly() const { return m_currentPly; }
+
+  // The move that leads from the board at 'ply' to the board at 'ply+1'.
+  const Move& getMove(int ply) const { return m_moves[ply]; }
+
+  const Board& getStartBoard() const { return m_startBoard; }
+  const Board& getCurrentBoard() const { return m_currentBoard; }
+  Board getBoard(int ply) const;
+
+  // The boards up to the current position, with the current board on top.
+  const RepetitionStack& getRepetitions() const { return m_repetitions; }
+
+private:
+  Board m_startBoard;
+  Board m_currentBoard;
+  int   m_currentPly;
+
+  std::vector<Move> m_moves;
+  RepetitionStack   m_repetitions;
+};
+
+#endif
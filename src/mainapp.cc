@@ -17,10 +17,11 @@
 ***************************************************************************/
 
 #include "mainapp.hh"
-#include "algo_alphabeta.hh"
+#include "player_alphabeta.hh"
 #include "algo_random.hh"
 #include <assert.h>
 #include <boost/bind.hpp>
+#include <algorithm>
 #include "util.hh"
 
 AppState::AppState()
@@ -33,6 +34,7 @@ AppState::AppState()
 MainApp::Options::Options()
 {
   alwaysPauseOnAIPlayer=false;
+  fixedTTableSize_MB=0;
 }
 
 
@@ -59,19 +61,20 @@ MainApp::MainApp()
   : threadTunnel(NULL),
     hintID(-100000) // set to a large negative number to avoid collision with gameID
 {
+  ttableSize_MB = DEFAULT_TTABLE_SIZE_MB;
   experience = experience_ptr(new Experience);
 
   // initialize the two AI players
 
   for (int c=0;c<2;c++)
     {
-      TranspositionTable* tt = new TranspositionTable(TRANSPOSITION_TABLE_SIZE);
+      TranspositionTable* tt = new TranspositionTable(ttableSize_MB);
       ttable[c] = ttable_ptr(tt);
 
       PlayerIF_AlgoAB* algo = new PlayerIF_AlgoAB();
       player_computer[c] = player_ptr(algo);
 
-      algo->registerExperience(experience);
+      algo->getSearch().registerExperience(experience);
     }
 
   setShareTTables(true);
@@ -82,9 +85,9 @@ MainApp::MainApp()
     PlayerIF_AlgoAB* hintAlgo = new PlayerIF_AlgoAB;
     hint_computer = player_ptr(hintAlgo);
     hint_computer->setRuleSpec( control.getRuleSpec() );
-    hint_ttable = ttable_ptr(new TranspositionTable(TRANSPOSITION_TABLE_SIZE-1));
-    hintAlgo->registerTTable(hint_ttable);
-    hintAlgo->registerExperience(experience);
+    hint_ttable = ttable_ptr(new TranspositionTable(hintTTableSize_MB()));
+    hintAlgo->getSearch().registerTTable(hint_ttable);
+    hintAlgo->getSearch().registerExperience(experience);
   }
 
   // set the default players
@@ -129,6 +132,7 @@ void MainApp::setRules(rulespec_ptr rules, bool significantChange)
 
   control.registerRuleSpec(rules); 
   experience->reset();
+  loadEndgameDatabase();
 
   if (significantChange)
     { control.resetGame(); }
@@ -154,7 +158,12 @@ void MainApp::setPlayer(Player pl, player_ptr player)
 void MainApp::resetGame()
 {
   getBoardGUI()->removeHint();
+  hint_computer->cancelMove();
   control.resetGame();
+
+  // no search is running now, so we can apply a changed table size
+  resizeTTables();
+
   hint_computer->resetGame();
   getBoardGUI()->redrawBoard();
 
@@ -251,7 +260,7 @@ void MainApp::computeHint()
   hintID++;
 
   hint_gameID = control.getCurrentMoveID();
-  hint_computer->startMove(control.getCurrentBoard_noTemporary(), hintID);
+  hint_computer->startMove(control.getCurrentBoard_noTemporary(), control.getRepetitionHistory(), hintID);
 }
 
 
@@ -297,8 +306,77 @@ void MainApp::setShareTTables(bool share)
   for (int c=0;c<2;c++)
     {
       PlayerIF_AlgoAB* algo = dynamic_cast<PlayerIF_AlgoAB*>(player_computer[c].get());
-      algo->registerTTable(share_TT ? ttable[0] : ttable[c]);
+      algo->getSearch().registerTTable(share_TT ? ttable[0] : ttable[c]);
+    }
+}
+
+
+void MainApp::setTTableSize_MB(int sizeMB)
+{
+  if (options.fixedTTableSize_MB > 0)
+    { sizeMB = options.fixedTTableSize_MB; }
+
+  ttableSize_MB = sizeMB;
+
+  /* If the game has not started yet, we can resize immediately. Otherwise,
+     the new size will be used from the next game on. */
+
+  if (control.getHistorySize()==1 &&
+      control.getGameState().state != GameState::Moving)
+    {
+      hint_computer->cancelMove();
+      resizeTTables();
+    }
+}
+
+
+int MainApp::hintTTableSize_MB() const
+{
+  return std::max(ttableSize_MB/2, 1);
+}
+
+
+void MainApp::resizeTTables()
+{
+  for (int c=0;c<2;c++)
+    if (ttable[c]->getSize_MB() != ttableSize_MB)
+      { ttable[c]->resize(ttableSize_MB); }
+
+  if (hint_ttable->getSize_MB() != hintTTableSize_MB())
+    { hint_ttable->resize(hintTTableSize_MB()); }
+}
+
+
+void MainApp::setEndgameDatabaseDirectory(const std::string& dir)
+{
+  if (!options.fixedEGDBDirectory.empty())
+    { egdbDirectory = options.fixedEGDBDirectory; }
+  else
+    { egdbDirectory = dir; }
+
+  loadEndgameDatabase();
+}
+
+
+void MainApp::loadEndgameDatabase()
+{
+  egdb.reset();
+
+  if (!egdbDirectory.empty())
+    {
+      egdb = egdb_ptr(new EndgameDatabase(control.getRuleSpec(), egdbDirectory));
+
+      if (egdb->mapAvailableSubspaces()==0)
+	{ egdb.reset(); }
     }
+
+  /* The players keep a database that is currently used in a search,
+     so we can replace it at any time. */
+
+  for (int c=0;c<2;c++)
+    dynamic_cast<PlayerIF_AlgoAB*>(player_computer[c].get())->getSearch().registerEndgameDatabase(egdb);
+
+  dynamic_cast<PlayerIF_AlgoAB*>(hint_computer.get())->getSearch().registerEndgameDatabase(egdb);
 }
 
 
@@ -25,6 +25,7 @@
 #include "boardgui.hh"
 #include "appgui.hh"
 #include "learn.hh"
+#include "egdb.hh"
 #include "configmgr.hh"
 
 
@@ -94,6 +95,8 @@ public:
     Options();
 
     bool alwaysPauseOnAIPlayer;
+    int  fixedTTableSize_MB; // if >0, this overrides the configured size (set from the command-line)
+    std::string fixedEGDBDirectory; // if not empty, this overrides the configured directory (command-line)
   };
 
   Options options;
@@ -105,6 +108,16 @@ public:
   bool        getShareTTables()  { return share_TT; }
   void        setShareTTables(bool share);
 
+  /* Set the size of each transposition-table (the hint table gets half of it).
+     The tables are resized at the start of the next game. */
+  void        setTTableSize_MB(int sizeMB);
+  int         getTTableSize_MB() const { return ttableSize_MB; }
+
+  /* Directory with the endgame databases (empty for none). The databases for the
+     current rules are used by all AI players from their next move on. */
+  void        setEndgameDatabaseDirectory(const std::string& dir);
+  std::string getEndgameDatabaseDirectory() const { return egdbDirectory; }
+
   // --- hint AI ---
 
   void computeHint();
@@ -145,8 +158,16 @@ private:
   player_ptr     player_computer[2]; // A and B
   bool           share_TT;
   ttable_ptr     ttable[2];
+  int            ttableSize_MB;
   experience_ptr experience;
 
+  int  hintTTableSize_MB() const;
+  void resizeTTables(); // apply ttableSize_MB, no search may be running
+
+  std::string egdbDirectory;
+  egdb_ptr    egdb;
+  void loadEndgameDatabase(); // for the current rules
+
   // hint
 
   player_ptr hint_computer;
@@ -23,6 +23,8 @@
 
 #include <assert.h>
 #include <iostream>
+#include <string.h>
+#include <stdlib.h>
 
 
 int main(int argc, char **argv)
@@ -38,6 +40,30 @@ int main(int argc, char **argv)
   // start main application control
   MainApp::createMainAppSingleton();
 
+  // command-line options (the remaining ones are handled by the GUI toolkit)
+
+  for (int i=1;i<argc;i++)
+    {
+      if (strncmp(argv[i], "--ttable-size=", 14)==0)
+	{
+	  // transposition-table size in MB, overriding the configuration
+
+	  int sizeMB = atoi(argv[i]+14);
+	  if (sizeMB>0)
+	    {
+	      MainApp::app().options.fixedTTableSize_MB = sizeMB;
+	      MainApp::app().setTTableSize_MB(sizeMB);
+	    }
+	}
+      else if (strncmp(argv[i], "--egdb-dir=", 11)==0)
+	{
+	  // endgame-database directory, overriding the configuration
+
+	  MainApp::app().options.fixedEGDBDirectory = argv[i]+11;
+	  MainApp::app().setEndgameDatabaseDirectory(argv[i]+11);
+	}
+    }
+
   // init GUI
   //ApplicationGUI_Gnome::initApplicationGUI(argc, argv);
   ApplicationGUI_Gtk::initApplicationGUI(argc, argv);
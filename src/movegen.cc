@@ -0,0 +1,257 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "movegen.hh"
+
+#include <stdlib.h>
+#include <algorithm>
+
+
+void MoveHistory::clear()
+{
+  for (int i=0;i<MAXSEARCHDEPTH;i++)
+    for (int k=0;k<NKILLERS;k++)
+      m_killer[i][k] = PackedMove();
+
+  for (int f=0;f<=MAXPOSITIONS;f++)
+    for (int t=0;t<MAXPOSITIONS;t++)
+      m_history[f][t] = 0;
+}
+
+
+void MoveHistory::addCutoff(const Move& m, int ply, int levelsToGo)
+{
+  // killers
+
+  if (ply<MAXSEARCHDEPTH)
+    {
+      PackedMove pm(m);
+      PackedMove* killer = m_killer[ply];
+
+      if (killer[0] != pm)
+	{
+	  for (int k=NKILLERS-1;k>0;k--)
+	    killer[k] = killer[k-1];
+
+	  killer[0] = pm;
+	}
+    }
+
+  // history
+
+  int& h = m_history[fromIndex(m)][m.newPos];
+  h += levelsToGo*levelsToGo;
+
+  // scale down all counters before they can overflow, keeping their relative order
+
+  if (h > (1<<24))
+    {
+      for (int f=0;f<=MAXPOSITIONS;f++)
+	for (int t=0;t<MAXPOSITIONS;t++)
+	  m_history[f][t] /= 2;
+    }
+}
+
+
+StagedMoveGenerator::StagedMoveGenerator(const RuleSpec& rules, const Board& board, MoveStack& stack,
+					 PackedMove hashMove, const MoveHistory* history, int ply)
+  : m_ruleSpec(rules),
+    m_board(board),
+    m_stage(Stage_HashMove),
+    m_millClosingOnly(false),
+    m_history(history),
+    m_nKillers(0),
+    m_moves(stack.m_moves),
+    m_stackBase(stack.m_moves.size()),
+    m_nextMove(m_stackBase),
+    m_ply(ply)
+{
+  m_hashMove = hashMove;
+  m_hashMoveValid = (!hashMove.isNoMove() && rules.isValidCompleteMove(board, hashMove.unpack()));
+}
+
+
+StagedMoveGenerator::~StagedMoveGenerator()
+{
+  // release our moves from the stack (this does not free the memory)
+  m_moves.resize(m_stackBase);
+}
+
+
+void StagedMoveGenerator::generateStage(Stage stage)
+{
+  m_moves.resize(m_stackBase);
+  m_nextMove=m_stackBase;
+
+  switch (stage)
+    {
+    case Stage_MillClosing: m_ruleSpec.generateMoves(m_moves, m_board, RuleSpec::MillClosingMoves); break;
+    case Stage_Quiet:       m_ruleSpec.generateMoves(m_moves, m_board, RuleSpec::QuietMoves);       break;
+
+    case Stage_Killers:
+      if (m_history)
+	{
+	  const PackedMove* killer = m_history->getKillers(m_ply);
+
+	  for (int k=0; killer && k<MoveHistory::NKILLERS; k++)
+	    {
+	      /* Killers are quiet moves from other positions, we have to check whether they
+		 are valid here. Since they are quiet, they cannot appear in the mill-closing stage. */
+
+	      if (killer[k].isNoMove() || (m_hashMoveValid && killer[k]==m_hashMove))
+		continue;
+
+	      Move m = killer[k].unpack();
+	      if (m_ruleSpec.isValidCompleteMove(m_board, m))
+		{
+		  m_moves.push_back(m);
+		  m_killer[m_nKillers++] = killer[k];
+		}
+	    }
+	}
+      break;
+
+    default: break;
+    }
+}
+
+
+bool StagedMoveGenerator::isDuplicate(const Move& move) const
+{
+  if (!m_hashMoveValid && m_nKillers==0)
+    return false;
+
+  PackedMove pm(move);
+
+  if (m_hashMoveValid && pm == m_hashMove)
+    return true;
+
+  for (int k=0;k<m_nKillers;k++)
+    if (pm == m_killer[k])
+      return true;
+
+  return false;
+}
+
+
+bool StagedMoveGenerator::next(Move& move)
+{
+  for (;;)
+    {
+      switch (m_stage)
+	{
+	case Stage_HashMove:
+	  m_stage = Stage_MillClosing;
+	  generateStage(m_stage);
+
+	  if (m_hashMoveValid)
+	    {
+	      move = m_hashMove.unpack();
+	      return true;
+	    }
+	  break;
+
+	case Stage_MillClosing:
+	case Stage_Killers:
+	case Stage_Quiet:
+	  while (m_nextMove < m_moves.size())
+	    {
+	      // take the quiet move with the highest history counter next
+
+	      if (m_stage == Stage_Quiet && m_history)
+		{
+		  size_t best = m_nextMove;
+		  int    bestHistory = m_history->getHistory(m_moves[best]);
+
+		  for (size_t i=m_nextMove+1; i<m_moves.size(); i++)
+		    {
+		      int h = m_history->getHistory(m_moves[i]);
+		      if (h > bestHistory) { best=i; bestHistory=h; }
+		    }
+
+		  std::swap(m_moves[m_nextMove], m_moves[best]);
+		}
+
+	      // NOTE: the move has to be copied, because the stack may be reallocated by child plies
+	      move = m_moves[m_nextMove++];
+
+	      // the hash move and the killers have already been returned
+	      if (m_stage != Stage_Killers && isDuplicate(move))
+		continue;
+
+	      return true;
+	    }
+
+	  /**/ if (m_stage == Stage_MillClosing) { m_stage = m_millClosingOnly ? Stage_Done : Stage_Killers; }
+	  else if (m_stage == Stage_Killers)     { m_stage = Stage_Quiet; }
+	  else                                   { m_stage = Stage_Done;  }
+
+	  generateStage(m_stage);
+	  break;
+
+	case Stage_Done:
+	  return false;
+	}
+    }
+}
+
+
+void StagedMoveGenerator::randomizeOrder()
+{
+  assert(m_stage == Stage_HashMove);
+
+  // generate all stages into one list, the hash move in front
+
+  m_moves.resize(m_stackBase);
+  m_nextMove=m_stackBase;
+
+  if (m_hashMoveValid)
+    {
+      m_moves.push_back(m_hashMove.unpack());
+    }
+
+  const size_t firstGenerated = m_moves.size();
+  m_ruleSpec.generateMoves(m_moves, m_board, RuleSpec::MillClosingMoves);
+  m_ruleSpec.generateMoves(m_moves, m_board, RuleSpec::QuietMoves);
+
+  // remove the duplicate of the hash move
+
+  if (m_hashMoveValid)
+    for (size_t i=firstGenerated;i<m_moves.size();i++)
+      if (PackedMove(m_moves[i]) == m_hashMove)
+	{
+	  m_moves.erase(m_moves.begin()+i);
+	  break;
+	}
+
+  // shuffle all moves except the first one
+
+  const int nMoves = m_moves.size() - m_stackBase;
+  for (int i=1;i<nMoves;i++)
+    {
+      int idx2 = (rand() % (nMoves-i)) +i;
+
+      std::swap(m_moves[m_stackBase+i], m_moves[m_stackBase+idx2]);
+    }
+
+  // return the moves in the final stage, without checking for the hash move again or reordering them
+
+  m_hashMoveValid = false;
+  m_history = NULL;
+  m_stage = Stage_Quiet;
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef MOVEGEN_HH
+#define MOVEGEN_HH
+
+#include "rules.hh"
+#include <vector>
+
+
+/* The move stack holds the generated moves of all plies of a search in one contiguous
+   array. Each StagedMoveGenerator appends its moves on top of the moves of its parent ply
+   and releases them again when it is destroyed. The memory is kept between searches, such
+   that no allocations happen anymore once the stack has grown to its maximum size.
+ */
+class MoveStack
+{
+public:
+  MoveStack() { m_moves.reserve(MAXSEARCHDEPTH*64); }
+
+  // Release all moves (e.g., left over from an aborted search).
+  void clear() { m_moves.clear(); }
+
+private:
+  friend class StagedMoveGenerator;
+
+  std::vector<Move> m_moves;
+};
+
+
+/* Move ordering statistics collected during a search: quiet moves that caused a beta
+   cut-off are remembered as killer moves of their ply (the most recent two), and their
+   history counter (indexed by from/to position) is increased by depth^2.
+ */
+class MoveHistory
+{
+public:
+  MoveHistory() { clear(); }
+
+  enum { NKILLERS=2 };
+
+  void clear();
+
+  // record a quiet move that caused a beta cut-off
+  void addCutoff(const Move&, int ply, int levelsToGo);
+
+  const PackedMove* getKillers(int ply) const { return ply<MAXSEARCHDEPTH ? m_killer[ply] : NULL; }
+  int getHistory(const Move& m) const { return m_history[fromIndex(m)][m.newPos]; }
+
+private:
+  PackedMove m_killer[MAXSEARCHDEPTH][NKILLERS];
+  int        m_history[MAXPOSITIONS+1][MAXPOSITIONS]; // from (MAXPOSITIONS for set-moves), to
+
+  static int fromIndex(const Move& m) { return m.mode==Move::Mode_Move ? m.oldPos : MAXPOSITIONS; }
+};
+
+
+/* A staged move generator for the search. Instead of generating the complete
+   list of moves in advance, the moves are generated in stages, and each stage
+   is only generated when the previous one is exhausted:
+   1. the hash move (usually the best move from the transposition table), if it is valid,
+   2. moves that close a mill, expanded with all their takes,
+   3. the killer moves of this ply, if they are valid,
+   4. quiet moves, in the order of their history counters.
+   Since most nodes have a cut-off after the first few moves, the later stages
+   are often never generated. Without a MoveHistory, stage 3 is skipped and the
+   quiet moves are returned in generation order.
+ */
+class StagedMoveGenerator
+{
+public:
+  StagedMoveGenerator(const RuleSpec&, const Board&, MoveStack&, PackedMove hashMove=PackedMove(),
+		      const MoveHistory* history=NULL, int ply=0);
+  ~StagedMoveGenerator();
+
+  // Get the next move. Returns false if there are no more moves.
+  bool next(Move&);
+
+  /* Generate all remaining stages at once and randomly shuffle their order.
+     The hash move (if any) stays at the first position. */
+  void randomizeOrder();
+
+  // Only return the hash move and the mill-closing moves (for the quiescence search).
+  void restrictToMillClosing() { m_millClosingOnly=true; }
+
+  // Whether the last move returned is an ordinary move (not the hash move, mill-closing, or a killer).
+  bool isQuietMove() const { return m_stage == Stage_Quiet; }
+
+private:
+  enum Stage { Stage_HashMove, Stage_MillClosing, Stage_Killers, Stage_Quiet, Stage_Done };
+
+  const RuleSpec& m_ruleSpec;
+  const Board&    m_board;
+
+  Stage m_stage;
+  PackedMove m_hashMove; // packed for fast comparison against the generated moves
+  bool       m_hashMoveValid;
+  bool       m_millClosingOnly;
+
+  const MoveHistory* m_history;
+  PackedMove m_killer[MoveHistory::NKILLERS]; // the valid killers that have been returned
+  int        m_nKillers;
+
+  std::vector<Move>& m_moves;    // the move stack, moves of the current stage are on top
+  const size_t       m_stackBase; // start of this generator's moves on the stack
+  size_t             m_nextMove;
+  const int          m_ply;
+
+  void generateStage(Stage);
+  bool isDuplicate(const Move&) const; // move has been returned in an earlier stage
+};
+
+#endif
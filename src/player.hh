@@ -21,6 +21,7 @@
 
 #include "board.hh"
 #include "rules.hh"
+#include "gamerecord.hh"
 #include "threadtunnel.hh"
 
 
@@ -54,11 +55,13 @@ public:
   virtual bool isInteractivePlayer() const { return false; }
 
   virtual void resetGame() { }
-  virtual void startMove(const Board& current, int moveID) = 0; // start this player's move
+  /* Start this player's move. The history contains the boards of the game so far, with
+     the current board on top (unless 'current' is the intermediate board of a partial move). */
+  virtual void startMove(const Board& current, const RepetitionStack& history, int moveID) = 0;
   virtual void forceMove() { }  // stop thinking process and move as soon as possible
   virtual void cancelMove() { } // stop thinking and do not move, will join the algo-thread
 
-  virtual void notifyWinner(Player p) { }
+  virtual void notifyWinner(Player p, const GameRecord& game) { }
 
 protected:
   Player       m_selfPlayer;
@@ -0,0 +1,100 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "player_alphabeta.hh"
+
+
+PlayerIF_AlgoAB::PlayerIF_AlgoAB()
+  : m_moveID(0),
+    m_tunnel(NULL),
+    m_thread(NULL),
+    m_ignoreMove(false)
+{
+}
+
+
+void startSearchThread(PlayerIF_AlgoAB*);
+
+void PlayerIF_AlgoAB::startMove(const Board& curr, const RepetitionStack& history, int moveID)
+{
+  m_search.setRuleSpec(m_ruleSpec);
+
+  m_board   = curr;
+  m_history = history;
+  m_moveID  = moveID;
+  m_ignoreMove = false;
+  m_search.clearStop();
+
+  m_thread = g_thread_new(NULL, (GThreadFunc)startSearchThread, this);
+}
+
+
+// kicker
+void startSearchThread(PlayerIF_AlgoAB* player)
+{
+  player->runSearch();
+}
+
+
+void PlayerIF_AlgoAB::runSearch()
+{
+  AlphaBetaSearch::SearchResult result = m_search.search(m_board, m_history, m_limits);
+
+  if (!m_ignoreMove) { m_tunnel->doMove(result.move, m_moveID); }
+  installJoinThreadHandler();
+}
+
+
+void PlayerIF_AlgoAB::installJoinThreadHandler()
+{
+  class IdleFunc_JoinAlgoThread : public IdleFunc
+  {
+  public:
+    IdleFunc_JoinAlgoThread(PlayerIF_AlgoAB* algo) : obj(algo) { }
+
+    void operator()() { obj->joinThread(); }
+
+  private:
+    PlayerIF_AlgoAB* obj;
+  };
+
+  IdleFunc::install(new IdleFunc_JoinAlgoThread(this));
+}
+
+
+void PlayerIF_AlgoAB::forceMove()
+{
+  m_search.stop();
+}
+
+void PlayerIF_AlgoAB::cancelMove()
+{
+  m_ignoreMove=true;
+  m_search.stop();
+
+  joinThread();
+}
+
+void PlayerIF_AlgoAB::joinThread()
+{
+  if (m_thread)
+    {
+      g_thread_join(m_thread);
+      m_thread=NULL;
+    }
+}
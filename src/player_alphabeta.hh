@@ -0,0 +1,86 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef PLAYER_ALPHABETA_HH
+#define PLAYER_ALPHABETA_HH
+
+#include "player.hh"
+#include "algo_alphabeta.hh"
+#include <glib.h>
+
+
+/* The computer player of the application. It runs the AlphaBetaSearch in a separate
+   thread and sends the move through the thread-tunnel. The thread is joined by an
+   idle function of the GUI.
+ */
+class PlayerIF_AlgoAB : public PlayerIF
+{
+public:
+  PlayerIF_AlgoAB();
+
+  // the search algorithm, for its configuration
+  AlphaBetaSearch&       getSearch()       { return m_search; }
+  const AlphaBetaSearch& getSearch() const { return m_search; }
+
+  void registerThreadTunnel(ThreadTunnel& tunnel) { m_tunnel=&tunnel; m_search.registerObserver(&tunnel); }
+
+  // --- AI parameters ---
+
+  void setMaxTime_msec(int msecs) { m_limits.maxMSecs=msecs; }
+  void setMaxDepth(int d) { m_limits.maxDepth=d; }
+
+  int  askMaxTime_msec() const { return m_limits.maxMSecs; }
+  int  askMaxDepth() const { return m_limits.maxDepth; }
+
+  // --- standard methods ---
+
+  bool isInteractivePlayer() const { return false; }
+
+  // start a new game
+  void resetGame() { m_search.resetGame(); }
+
+  void startMove(const Board& curr, const RepetitionStack& history, int moveID);
+
+  // Carry out the move as soon as possible.
+  void forceMove();
+
+  // Cancel the current move (do not send the currently computed move).
+  void cancelMove();
+
+  void notifyWinner(Player p, const GameRecord& game) { m_search.learnFromGame(p, game); }
+
+private:
+  AlphaBetaSearch m_search;
+  AlphaBetaSearch::SearchLimits m_limits;
+
+  // the move that is computed in the search thread
+  Board m_board;
+  RepetitionStack m_history;
+  int   m_moveID;
+
+  class ThreadTunnel* m_tunnel;
+  GThread* m_thread;
+  volatile bool m_ignoreMove;
+
+  friend void startSearchThread(PlayerIF_AlgoAB*);
+  void runSearch();
+  void installJoinThreadHandler();
+  void joinThread();
+};
+
+#endif
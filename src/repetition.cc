@@ -0,0 +1,83 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#include "repetition.hh"
+
+#include <string.h>
+#include <assert.h>
+
+
+RepetitionStack::RepetitionStack()
+{
+  m_entries.reserve(MAXSEARCHDEPTH*4);
+  memset(m_filter, 0, sizeof(m_filter));
+}
+
+
+void RepetitionStack::clear()
+{
+  m_entries.clear();
+  memset(m_filter, 0, sizeof(m_filter));
+}
+
+
+void RepetitionStack::push(const Board& b, bool irreversible)
+{
+  Entry e;
+  e.hash     = b.getHash();
+  e.material = (b.getNPiecesOnBoard(PL_White) + b.getNPiecesOnBoard(PL_Black) +
+		2*(b.getNPiecesToSet(PL_White) + b.getNPiecesToSet(PL_Black)));
+
+  if (irreversible || m_entries.empty() || m_entries.back().material != e.material)
+    { e.windowStart = m_entries.size(); }
+  else
+    { e.windowStart = m_entries.back().windowStart; }
+
+  m_entries.push_back(e);
+  m_filter[filterIndex(e.hash)]++;
+}
+
+
+void RepetitionStack::pop()
+{
+  assert(!m_entries.empty());
+
+  m_filter[filterIndex(m_entries.back().hash)]--;
+  m_entries.pop_back();
+}
+
+
+int RepetitionStack::nRepetitions(int first) const
+{
+  assert(!m_entries.empty());
+
+  const Entry& e = m_entries.back();
+
+  // the board itself is the only one with these hash bits
+  if (m_filter[filterIndex(e.hash)] <= 1)
+    return 0;
+
+  if (first < e.windowStart) first = e.windowStart;
+
+  int n=0;
+  for (int i=m_entries.size()-2; i>=first; i--)
+    if (m_entries[i].hash == e.hash)
+      { n++; }
+
+  return n;
+}
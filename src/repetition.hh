@@ -0,0 +1,75 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef REPETITION_HH
+#define REPETITION_HH
+
+#include "board.hh"
+#include <vector>
+
+
+/* The hashes of all boards of a game (and of the current search path), for detecting
+   repeated positions.
+
+   A position cannot repeat after a piece has been set or taken. Each board is assigned
+   a material count (pieces on the board, plus twice the pieces still to set), which
+   decreases with every such move and stays the same for all other moves. Hence, only the
+   boards since the last change of the material count have to be compared.
+
+   Additionally, a small table counts the boards on the stack for each value of the lower
+   hash bits. Most boards have not occurred before, which the table tells without scanning
+   the stack at all.
+ */
+class RepetitionStack
+{
+public:
+  RepetitionStack();
+
+  void clear();
+
+  /* Add a board to the top of the stack. If 'irreversible' is set, this board and the
+     following ones are never compared to the boards below it (e.g., after a null move). */
+  void push(const Board&, bool irreversible=false);
+  void pop();
+
+  int  size() const { return m_entries.size(); }
+  bool empty() const { return m_entries.empty(); }
+
+  BoardHash top() const { return m_entries.back().hash; }
+
+  /* The number of times the board on top of the stack occurred before, counting only
+     the boards at stack positions 'first' and above. */
+  int  nRepetitions(int first=0) const;
+
+private:
+  enum { FILTER_BITS=10, FILTER_SIZE=1<<FILTER_BITS };
+
+  struct Entry
+  {
+    BoardHash hash;
+    int       material;
+    int       windowStart; // first entry with the same material that the board can be compared to
+  };
+
+  std::vector<Entry> m_entries;
+  unsigned short     m_filter[FILTER_SIZE]; // number of entries for each value of the lower hash bits
+
+  static int filterIndex(BoardHash h) { return h & (FILTER_SIZE-1); }
+};
+
+#endif
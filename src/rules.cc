@@ -18,6 +18,8 @@
 
 #include "rules.hh"
 
+#include <string.h>
+
 
 std::string writeMove(const Move& m, boardspec_ptr spec)
 {
@@ -41,8 +43,45 @@ std::string writeMove(const Move& m, boardspec_ptr spec)
 }
 
 
+/* The board ID is a base-3 number with one digit per position (0: empty, 1: white, 2: black),
+   the first position being the most significant digit. It is computed from the position
+   masks as the sum of the digit weights of the occupied positions. */
+
+static BoardID digitWeight[MAXPOSITIONS+1][MAXPOSITIONS]; // [nPositions][position]
+static bool    digitWeightInitialized = false;
+
+static void initDigitWeights()
+{
+  if (digitWeightInitialized)
+    return;
+
+  for (int n=0;n<=MAXPOSITIONS;n++)
+    {
+      BoardID w=1;
+      for (int p=n-1;p>=0;p--)
+	{
+	  digitWeight[n][p] = w;
+	  w *= 3;
+	}
+    }
+
+  digitWeightInitialized = true;
+}
+
+static inline BoardID positionDigits(const BoardID* weight, PositionMask white, PositionMask black)
+{
+  BoardID id=0;
+  for (PositionMask m=white; m; m&=m-1) id +=   weight[ firstPositionInMask(m) ];
+  for (PositionMask m=black; m; m&=m-1) id += 2*weight[ firstPositionInMask(m) ];
+  return id;
+}
+
+
 RuleSpec::RuleSpec()
 {
+  // the tables are initialized here, before they are used from several search threads
+  initDigitWeights();
+
   laskerVariant=false;
   mayJump=true;
   mayTakeMultiple=false;
@@ -54,30 +93,20 @@ RuleSpec::RuleSpec()
 
 int RuleSpec::nPotentialMills(const Board& currentBoard, const Move& move) const
 {
-  const Player pl = currentBoard.getCurrentPlayer();
-  int cnt=0;
-
-  // get set of all mills through this position
+  // The moved piece does not count for the mill anymore.
 
-  const std::vector<MillPosVector>& mills = boardSpec->getMillsThroughPos(move.newPos);
+  PositionMask pieces = currentBoard.getPieces();
+  if (move.mode == Move::Mode_Move) { pieces &= ~positionBit(move.oldPos); }
 
-  // iterate through all mills
+  // If all other positions of a mill through 'newPos' are the player's pieces, it is a potential mill.
 
-  for (size_t i=0;i<mills.size();i++)
-    {
-      // if all positions (except 'newPos') are the player's pieces, it is a potential mill
-
-      bool isMill=true;
+  const PositionMask* mills = boardSpec->getMillPartnerMasks(move.newPos);
+  const int nMills = boardSpec->nMillsThroughPos(move.newPos);
 
-      for (int k=0;k<mills[i].size();k++)
-	{
-	  if (mills[i][k]==move.oldPos ||
-	      currentBoard.getPosition(mills[i][k]) != pl)
-	    { isMill = false; break; }
-	}
-
-      if (isMill) { cnt++; }
-    }
+  int cnt=0;
+  for (int i=0;i<nMills;i++)
+    if ((pieces & mills[i]) == mills[i])
+      { cnt++; }
 
   return cnt;
 }
@@ -85,23 +114,21 @@ int RuleSpec::nPotentialMills(const Board& currentBoard, const Move& move) const
 
 bool RuleSpec::isInMill(const Board& currBoard, Position pos) const
 {
-  const std::vector<MillPosVector>& mills = boardSpec->getMillsThroughPos(pos);
-
   const Player pl = currBoard.getPosition(pos);
+  assert(pl != PL_None);
 
-  for (size_t m=0;m<mills.size();m++)
-    {
-      assert(mills[m].size()==2);
+  return isInMill(currBoard.getPieces(pl), pos);
+}
 
-      bool isMill=true;
-      for (int i=0;i<mills[m].size();i++)
-	if (currBoard.getPosition( mills[m][i] )!=pl)
-	  {
-	    isMill=false; break;
-	  }
 
-      if (isMill) { return true; }
-    }
+bool RuleSpec::isInMill(PositionMask pieces, Position pos) const
+{
+  const PositionMask* mills = boardSpec->getMillPartnerMasks(pos);
+  const int nMills = boardSpec->nMillsThroughPos(pos);
+
+  for (int i=0;i<nMills;i++)
+    if ((pieces & mills[i]) == mills[i])
+      { return true; }
 
   return false;
 }
@@ -111,14 +138,19 @@ bool RuleSpec::mayTake(const Board& currBoard, Position pos) const
 {
   assert(currBoard.getPosition(pos) == opponent(currBoard.getCurrentPlayer()));
 
+  return mayTake(currBoard.getOpponentPieces(), pos);
+}
+
+
+bool RuleSpec::mayTake(PositionMask opponentPieces, Position pos) const
+{
   if (mayTakeFromMillsAlways) return true;
-  if (!isInMill(currBoard,pos)) return true;
+  if (!isInMill(opponentPieces,pos)) return true;
 
   bool onlyMills = true;
-  for (int i=0;i<boardSpec->nPositions();i++)
-    if (currBoard.getPosition(i) == opponent(currBoard.getCurrentPlayer()))
-      if (!isInMill(currBoard,i))
-	{ onlyMills = false; break; }
+  for (PositionMask m=opponentPieces; m; m&=m-1)
+    if (!isInMill(opponentPieces,firstPositionInMask(m)))
+      { onlyMills = false; break; }
 
   if (onlyMills) return true;
   else return false;
@@ -126,76 +158,75 @@ bool RuleSpec::mayTake(const Board& currBoard, Position pos) const
 
 
 // generate all possible takes for the set/move-part of the partial move 'm'
-void RuleSpec::generateTakes(std::vector<Move>& output, const Move& m, const Board& currBoard, int n) const
+void RuleSpec::generateTakes(std::vector<Move>& output, const Move& m, PositionMask opponentPieces, int n) const
 {
   assert(n>0);
 
-  const Player other = currBoard.getOpponentPlayer();
-
-
   // First try to generate takes assuming that not all opponent pieces are within mills
   // (or that it is irrelevant, because we may take any piece).
 
   bool takesGenerated = false;
 
-  for (int i=0;i<boardSpec->nPositions();i++)
-    if (currBoard.getPosition(i) == other)
-      {
-	if (mayTakeFromMillsAlways ||
-	    isInMill(currBoard, i) == false)
-	  {
-	    Move move = m;
-	    move.addTake(i);
-
-	    takesGenerated=true;
-
-	    if (n==1)
-	      {
-		// move complete, add to set
-		output.push_back(move);
-	      }
-	    else
-	      {
-		// we may add more takes, continue recursively
-		Board tmpBoard = currBoard;
-		tmpBoard.setPosition_noHash(i, PL_None);
-		generateTakes(output, move, tmpBoard, n-1);
-	      }
-	  }
-      }
+  for (PositionMask other=opponentPieces; other; other&=other-1)
+    {
+      const Position i = firstPositionInMask(other);
+
+      if (mayTakeFromMillsAlways ||
+	  isInMill(opponentPieces, i) == false)
+	{
+	  Move move = m;
+	  move.addTake(i);
+
+	  takesGenerated=true;
+
+	  if (n==1)
+	    {
+	      // move complete, add to set
+	      output.push_back(move);
+	    }
+	  else
+	    {
+	      // we may add more takes, continue recursively
+	      generateTakes(output, move, opponentPieces & ~positionBit(i), n-1);
+	    }
+	}
+    }
 
   // If we could not take any opponent pieces (because all are in mills),
   // we are allowed to take any opponent piece we want (from mills).
 
   if (!takesGenerated)
     {
-      for (int i=0;i<boardSpec->nPositions();i++)
-	if (currBoard.getPosition(i) == other)
-	  {
-	    Move move = m;
-	    move.addTake(i);
-
-	    if (n==1)
-	      {
-		output.push_back(move);
-	      }
-	    else
-	      {
-		Board tmpBoard = currBoard;
-		tmpBoard.setPosition_noHash(i, PL_None);
-		generateTakes(output, move, tmpBoard, n-1);
-	      }
-	  }
+      for (PositionMask other=opponentPieces; other; other&=other-1)
+	{
+	  const Position i = firstPositionInMask(other);
+
+	  Move move = m;
+	  move.addTake(i);
+
+	  if (n==1)
+	    {
+	      output.push_back(move);
+	    }
+	  else
+	    {
+	      generateTakes(output, move, opponentPieces & ~positionBit(i), n-1);
+	    }
+	}
     }
 }
 
 
 void RuleSpec::addTakesToMoveIfMillClosed(std::vector<Move>& output,
 					  const Move& m,
-					  const class Board& currBoard) const
+					  const class Board& currBoard,
+					  MoveSelection selection) const
 {
   int nMills = nPotentialMills(currBoard, m);
 
+  if (selection==MillClosingMoves && nMills==0) { return; }
+  if (selection==QuietMoves       && nMills>0)  { return; }
+
   if (nMills==0)
     {
       // no mills closed, do not add takes
@@ -211,29 +242,31 @@ void RuleSpec::addTakesToMoveIfMillClosed(std::vector<Move>& output,
 	  nMills=1;
 	}
 
-      generateTakes(output, m, currBoard, nMills);
+      generateTakes(output, m, currBoard.getOpponentPieces(), nMills);
     }
 }
 
 
-void RuleSpec::generateMoves(std::vector<Move>& output, const Board& currBoard) const
+void RuleSpec::generateMoves(std::vector<Move>& output, const Board& currBoard,
+			     MoveSelection selection) const
 {
   const bool maySet  = (currBoard.getNPiecesToSet()>0);
   const bool mayMove = (currBoard.getNPiecesToSet()==0) || laskerVariant;
   const bool mayFly  = mayJump && (currBoard.getNPiecesLeft()==3);
 
+  const PositionMask empty = boardSpec->getPositionsMask() & ~currBoard.getOccupied();
+
 
   // generate set-moves
 
   if (maySet)
     {
-      for (int i=0;i<boardSpec->nPositions();i++)
-	if (currBoard.getPosition(i) == PL_None)
-	  {
-	    Move m;
-	    m.setMove_Set(i);
-	    addTakesToMoveIfMillClosed(output,m,currBoard);
-	  }
+      for (PositionMask m=empty; m; m&=m-1)
+	{
+	  Move move;
+	  move.setMove_Set(firstPositionInMask(m));
+	  addTakesToMoveIfMillClosed(output,move,currBoard,selection);
+	}
     }
 
 
@@ -241,41 +274,36 @@ void RuleSpec::generateMoves(std::vector<Move>& output, const Board& currBoard)
 
   if (mayMove)
     {
-      for (int i=0;i<boardSpec->nPositions();i++)
-	if (currBoard.getPosition(i) == currBoard.getCurrentPlayer())
-	  {
-	    if (mayFly)
-	      {
-		for (int k=0;k<boardSpec->nPositions();k++)
-		  {
-		    if (k!=i && currBoard.getPosition(k) == PL_None)
-		      {
-			Move m;
-			m.setMove_Move(i,k);
-			addTakesToMoveIfMillClosed(output,m,currBoard);
-		      }
-		  }
-	      }
-	    else
-	      {
-		const NeighborVector& v = boardSpec->getNeighbors(i);
-		for (int n=0;n<v.size();n++)
-		  {
-		    if (currBoard.getPosition(v[n]) == PL_None)
-		      {
-			Move m;
-			m.setMove_Move(i,v[n]);
-			addTakesToMoveIfMillClosed(output,m,currBoard);
-		      }
-		  }
-	      }
-	  }
+      for (PositionMask from=currBoard.getPieces(); from; from&=from-1)
+	{
+	  const Position i = firstPositionInMask(from);
+
+	  // flying pieces may go to any empty position, all others only to empty neighbors
+
+	  PositionMask to = empty;
+	  if (!mayFly) { to &= boardSpec->getNeighborMask(i); }
+
+	  for ( ; to; to&=to-1)
+	    {
+	      Move move;
+	      move.setMove_Move(i,firstPositionInMask(to));
+	      addTakesToMoveIfMillClosed(output,move,currBoard,selection);
+	    }
+	}
     }
 }
 
 
+static inline bool onBoard(Position p, const BoardSpec& spec)
+{
+  return p>=0 && p<spec.nPositions();
+}
+
+
 bool RuleSpec::isValidMove(const Board& b, const Move& m) const
 {
+  if (!onBoard(m.newPos, *boardSpec)) { return false; }
+
   switch (m.mode)
     {
     case Move::Mode_Set:
@@ -283,6 +311,7 @@ bool RuleSpec::isValidMove(const Board& b, const Move& m) const
       break;
 
     case Move::Mode_Move:
+      if (!onBoard(m.oldPos, *boardSpec))   { return false; }
       if (b.getPosition(m.newPos)!=PL_None) { return false; }
       if (b.getPosition(m.oldPos)!=b.getCurrentPlayer()) { return false; }
 
@@ -292,22 +321,52 @@ bool RuleSpec::isValidMove(const Board& b, const Move& m) const
 	}
       else
 	{
-	  const NeighborVector& n = boardSpec->getNeighbors(m.oldPos);
-	  for (int i=0;i<n.size();i++)
-	    if (n[i]==m.newPos)
-	      return true;
-
-	  return false;
+	  return boardSpec->getNeighborMask(m.oldPos) & positionBit(m.newPos);
 	}
 
       break;
     }
 
-  assert(0);
+  return false;
+}
+
+
+bool RuleSpec::isValidCompleteMove(const Board& b, const Move& m) const
+{
+  // check the set/move part
+
+  if (m.mode == Move::Mode_Set  && b.getNPiecesToSet()==0) { return false; }
+  if (m.mode == Move::Mode_Move && b.getNPiecesToSet()>0 && !laskerVariant) { return false; }
+
+  if (!isValidMove(b,m)) { return false; }
+
+  for (int i=0;i<m.takes.size();i++)
+    if (!onBoard(m.takes[i], *boardSpec)) { return false; }
+
+  // check the number of takes
+
+  int nTakes = nPotentialMills(b,m);
+  if (nTakes>0 && mayTakeMultiple==false)
+    nTakes=1;
+
+  if (m.takes.size() != nTakes) { return false; }
+
+  // check that each take is allowed, considering the pieces that were taken before
+
+  PositionMask opponentPieces = b.getOpponentPieces();
+  for (int i=0;i<m.takes.size();i++)
+    {
+      if (!(opponentPieces & positionBit(m.takes[i]))) { return false; }
+      if (!mayTake(opponentPieces, m.takes[i]))       { return false; }
+
+      opponentPieces &= ~positionBit(m.takes[i]);
+    }
+
+  return true;
 }
 
 
-bool RuleSpec::isGameOver(const Board& b, Player* winner) const
+bool RuleSpec::isGameOver(const Board& b, const RepetitionStack& history, Player* winner) const
 {
   if (currentPlayerHasWon(b))
     {
@@ -321,7 +380,7 @@ bool RuleSpec::isGameOver(const Board& b, Player* winner) const
       return true;
     }
 
-  if (tieBetweenBothPlayers(b))
+  if (tieBetweenBothPlayers(history))
     {
       if (winner) *winner = PL_None;
       return true;
@@ -348,14 +407,13 @@ bool RuleSpec::currentPlayerHasLost(const Board& b) const
 
   // have to move (no piece to set anymore), but no freedom
   int freedom=0;
-  for (int i=0;i<boardSpec->nPositions();i++)
-    if (b.isPlayer(i))
-      {
-	freedom=freedomAtPosition(b,i);
+  for (PositionMask m=b.getPieces(); m; m&=m-1)
+    {
+      freedom=freedomAtPosition(b,firstPositionInMask(m));
 
-	if (freedom>0)
-	  break;
-      }
+      if (freedom>0)
+	break;
+    }
 
   if (freedom==0 &&
       b.getNPiecesToSet()==0 &&
@@ -371,32 +429,11 @@ bool RuleSpec::currentPlayerHasLost(const Board& b) const
 }
 
 
-bool RuleSpec::tieBetweenBothPlayers(const Board& b) const
+bool RuleSpec::tieBetweenBothPlayers(const RepetitionStack& history) const
 {
   if (tieAfterNRepeats==0) { return false; }
 
-  int repeatCnt = 0;
-
-  const Board* curr = &b;
-  const Board* prev;
-
-  for (;;)
-    {
-      prev = curr->getPrevBoard().get();
-
-      if (prev==NULL)
-	break;
-
-      if (*prev==b)
-	{ repeatCnt++; }
-
-      if (repeatCnt==tieAfterNRepeats)
-	return true;
-
-      curr=prev;
-    }
-
-  return false;
+  return history.nRepetitions() >= tieAfterNRepeats;
 }
 
 
@@ -497,23 +534,47 @@ rulespec_ptr RuleSpec::createPresetRule(enum RulePreset p)
   return rule;
 }
 
+const RuleSpec::PresetName RuleSpec::presetNames[] =
+  {
+    { "standard",   Preset_Standard },
+    { "lasker",     Preset_Lasker },
+    { "moebius",    Preset_Moebius },
+    { "morabaraba", Preset_Morabaraba },
+    { "windmill",   Preset_Windmill },
+    { "sunmill",    Preset_Sunmill },
+    { "6mm",        Preset_6MM },
+    { "7mm",        Preset_7MM },
+    { "tapatan",    Preset_Tapatan },
+    { "achi",       Preset_Achi },
+    { "smalltri",   Preset_SmallTri },
+    { "nineholes",  Preset_NineHoles },
+    { "polygon3",   Preset_Polygon3 },
+    { "polygon5",   Preset_Polygon5 },
+    { "polygon6",   Preset_Polygon6 },
+    { NULL }
+  };
+
+
+rulespec_ptr RuleSpec::createPresetRule(const char* name)
+{
+  for (int i=0;presetNames[i].name;i++)
+    if (strcmp(presetNames[i].name, name)==0)
+      return createPresetRule(presetNames[i].preset);
+
+  return rulespec_ptr();
+}
+
 
 BoardID RuleSpec::getBoardID(const Board& board) const
 {
+  const int nPos = boardSpec->nPositions();
+
   BoardID id=0;
   id += board.getNPiecesToSet(PL_White); id *= nPieces+1;
   id += board.getNPiecesToSet(PL_Black);
 
-  const int nPos = boardSpec->nPositions();
-  for (int p=0;p<nPos;p++)
-    {
-      id *= 3;
-
-      int pl = board.getPosition(p);
-      if (pl<0) pl=2;
-
-      id += pl;
-    }
+  id *= digitWeight[nPos][0]*3; // 3^nPos
+  id += positionDigits(digitWeight[nPos], board.getPieces(PL_White), board.getPieces(PL_Black));
 
   id *= 2;
   id += player2Index( board.getCurrentPlayer() );
@@ -524,19 +585,32 @@ BoardID RuleSpec::getBoardID(const Board& board) const
 
 BoardID RuleSpec::getBoardID_Symmetric(const Board& board) const
 {
-  const std::vector<BoardSpec::Permutation>& permutations = boardSpec->getPermutations();
+  const int nPos = boardSpec->nPositions();
+  const int nPermutations = boardSpec->getPermutations().size();
+
+  const PositionMask white = board.getPieces(PL_White);
+  const PositionMask black = board.getPieces(PL_Black);
+
+  // the parts of the ID that do not change with the permutations
 
-  // Compute all symmetric permutations of the board position and determine the board ID for each.
+  BoardID prefix=0;
+  prefix += board.getNPiecesToSet(PL_White); prefix *= nPieces+1;
+  prefix += board.getNPiecesToSet(PL_Black);
+  prefix *= digitWeight[nPos][0]*3;
+
+  const BoardID player = player2Index( board.getCurrentPlayer() );
+
+  // Compute the board ID for all symmetric permutations of the board position.
   // Return the lowest ID.
 
-  Board b = board;  // TODO: setting only the meta-information would be faster (next player, pieces to set)
-  BoardID id;
-  for (int i=0;i<permutations.size();i++)
+  BoardID id=0;
+  for (int i=0;i<nPermutations;i++)
     {
-      for (int p=0;p<boardSpec->nPositions();p++)
-	b.setPosition_noHash( permutations[i][p], board.getPosition(p) );
+      BoardID newid = positionDigits(digitWeight[nPos],
+				     boardSpec->permuteMask(i, white),
+				     boardSpec->permuteMask(i, black));
+      newid = (prefix + newid)*2 + player;
 
-      BoardID newid = getBoardID(b);
       if (i==0 || newid<id)
 	id=newid;
     }
@@ -21,6 +21,7 @@
 
 #include "boardspec.hh"
 #include "board.hh"
+#include "repetition.hh"
 
 
 /* Write the move in human-readable notation.
@@ -63,10 +64,15 @@ public:
      a mill and whether there are other pieces, not part of a mill. */
   bool mayTake(const Board&, Position) const;
 
-  /* Check whether the given move is valid.
+  /* Check whether the given move is valid. The positions may be arbitrary (e.g., from a
+     corrupted table entry), they are checked to be on the board before they are used.
      NOTE: the takes in this move are ignored ! */
   bool isValidMove(const Board&, const Move&) const;
 
+  /* Check whether the given move is valid, including the correct number of valid takes.
+     This is used for moves from other sources than the move generator (e.g. hash tables). */
+  bool isValidCompleteMove(const Board&, const Move&) const;
+
   /* The number of empty direct neighbors to the specified piece. */
   int  freedomAtPosition(const Board&, Position) const;
 
@@ -76,17 +82,19 @@ public:
 
   // --- game state ---
 
-  // Whether the current situation is a game-over.
-  bool isGameOver(const Board&, Player* winner=NULL) const;
+  // Whether the current situation is a game-over. The board has to be on top of the history.
+  bool isGameOver(const Board&, const RepetitionStack& history, Player* winner=NULL) const;
   bool currentPlayerHasWon(const Board&) const;
   bool currentPlayerHasLost(const Board&) const;
 
-  /* This checks for the current game history for board repetitions, if ties are enabled.
-     For this to work, the chain of previous boards has to be set correctly.
+  /* This checks the game history for repetitions of the current board (the top of the
+     stack), if ties are enabled.
    */
-  bool tieBetweenBothPlayers(const Board&) const;
+  bool tieBetweenBothPlayers(const RepetitionStack& history) const;
 
-  // Get a unique ID for the current board.
+  /* Get a unique ID for the current board.
+     The IDs are not dense. For dense indices within the subspaces of equal piece counts,
+     see BoardRanking (boardrank.hh). */
   BoardID getBoardID(const Board& board) const;
 
   // Get a unique ID for the current board, considering symmetries. I.e. a similar situation,
@@ -96,9 +104,17 @@ public:
 
   // --- move generator ---
 
+  enum MoveSelection
+    {
+      AllMoves,
+      MillClosingMoves,  // only moves that close a mill (with their takes)
+      QuietMoves         // only moves that do not close a mill
+    };
+
   // Generate a set of valid moves for the current board.
   // NOTE: the 'output' set is not cleared in this function.
-  void generateMoves(std::vector<Move>& output, const class Board& currentBoard) const;
+  void generateMoves(std::vector<Move>& output, const class Board& currentBoard,
+		     MoveSelection selection=AllMoves) const;
 
   // --- rule factory ---
 
@@ -124,15 +140,36 @@ public:
   // Initialize the rules to one of the preset.
   static rulespec_ptr createPresetRule(enum RulePreset);
 
+  /* Short names of the presets (e.g., "standard", "6mm"), for the command line tools.
+     The list is terminated by an entry with a NULL name. */
+  struct PresetName
+  {
+    const char* name;
+    RulePreset  preset;
+  };
+
+  static const PresetName presetNames[];
+
+  // Initialize the rules to the preset with the given short name. Returns NULL for unknown names.
+  static rulespec_ptr createPresetRule(const char* name);
+
 private:
-  // Take the specified move as template and add all possible takes of 'n' opponent pieces.
-  void generateTakes(std::vector<Move>& output, const Move&, const class Board& currentBoard, int n) const;
+  /* Take the specified move as template and add all possible takes of 'n' opponent pieces.
+     'opponentPieces' are the opponent pieces that are still on the board (not taken yet). */
+  void generateTakes(std::vector<Move>& output, const Move&, PositionMask opponentPieces, int n) const;
+
+  // Whether the piece at 'pos' forms a mill with the other 'pieces'.
+  bool isInMill(PositionMask pieces, Position pos) const;
+
+  // Same as mayTake() above, but considering only the given opponent pieces.
+  bool mayTake(PositionMask opponentPieces, Position) const;
 
   /* Check is a mill will be closed by the specified move and if yes, extend the move with all
      possible takes and add to the set. Otherwise (if no mill was closed), simply add the move
      to the set (without takes).
   */
-  void addTakesToMoveIfMillClosed(std::vector<Move>& output, const Move& m,const class Board& currentBoard) const;
+  void addTakesToMoveIfMillClosed(std::vector<Move>& output, const Move& m,const class Board& currentBoard,
+				  MoveSelection selection) const;
 };
 
 
@@ -142,13 +179,7 @@ private:
  */
 inline int RuleSpec::freedomAtPosition(const Board& b, Position p) const
 {
-  const NeighborVector& v = boardSpec->getNeighbors(p);
-  int cnt=0;
-  for (int i=0;i<v.size();i++)
-    if (b.isEmpty(v[i]))
-      cnt++;
-
-  return cnt;    
+  return nPositionsInMask(boardSpec->getNeighborMask(p) & ~b.getOccupied());
 }
 
 #endif
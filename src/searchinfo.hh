@@ -0,0 +1,58 @@
+/***************************************************************************
+  This file is part of Morris.
+  Copyright (C) 2009 Dirk Farin <dirk.farin@gmail.com>
+
+  Morris is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***************************************************************************/
+
+#ifndef SEARCHINFO_HH
+#define SEARCHINFO_HH
+
+#include "board.hh"
+#include <vector>
+#include <string>
+
+
+/* Progress of a search, sent after each completed iteration. */
+struct SearchInfo
+{
+  int depth;
+  int eval;        // in 1/100 pieces, from the view of the player to move
+  int winInMoves;  // >0: the player to move wins in this many moves, <0: loses, 0: not decided
+  long nodes;      // nodes searched so far
+  int  msecs;      // time since the start of the search
+  std::vector<Move> pv;
+};
+
+
+/* Receives the progress of a search. The methods are called from the thread that
+   runs the search, so implementations that show the progress in a GUI have to pass
+   it on to the main thread (see ThreadTunnel).
+ */
+class SearchObserver
+{
+public:
+  virtual ~SearchObserver() { }
+
+  // Set the progress bar in the status-line (value is in [0;1]).
+  virtual void setProgress(float progress) { }
+
+  // Show some additional information about the AI thinking-process in the statusbar.
+  virtual void showThinkingInfo(const std::string&) { }
+
+  // Detailed progress of the search, for front-ends that display it themselves.
+  virtual void showSearchInfo(const SearchInfo&) { }
+};
+
+#endif
@@ -20,6 +20,7 @@
 #define THREADTUNNEL_HH
 
 #include "board.hh"
+#include "searchinfo.hh"
 
 
 /* The thread-tunnel provides the interface through which the players
@@ -28,7 +29,7 @@
    have to send their messages as inter-thread messages. The thread-tunnel
    performs this inter-thread message forwarding.
  */
-class ThreadTunnel
+class ThreadTunnel : public SearchObserver
 {
 public:
   ThreadTunnel() {} 
@@ -36,11 +37,7 @@ public:
 
   // --- thread tunnels ---
 
-  // Set the progress bar in the status-line (value is in [0;1]).
-  virtual void setProgress(float progress) { }
-
-  // Show some additional information about the AI thinking-process in the statusbar.
-  virtual void showThinkingInfo(const std::string&) { }
+  // (the progress of the search is sent through the SearchObserver methods)
 
   // Send move to main application.
   virtual void doMove(Move m, int moveID) = 0;
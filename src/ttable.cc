@@ -19,118 +19,264 @@
 #include "ttable.hh"
 
 #include <iostream>
+#include <new>
+#include <assert.h>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+
+TranspositionTable::TranspositionTable(int p_sizeMB)
+  : memory(NULL),
+    memorySize(0),
+    table(NULL),
+    nBuckets(0)
+{
+  age=0;
+  lookups=hits=collisions=misses=0;
+
+  resize(p_sizeMB);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+  release();
+}
 
-// 16 -   65536
-// 17 -  131072
-// 18 -  262144
-// 19 -  524288
-// 20 - 1048576
-TranspositionTable::TranspositionTable(int nBits)
+void TranspositionTable::resize(int p_sizeMB)
 {
-  tableSize = 1<<nBits;
-  table = new Entry[tableSize];
+  assert(p_sizeMB >= 1);
 
-  mask=0;
-  for (int i=0;i<nBits;i++)
+  release();
+
+  sizeMB = p_sizeMB;
+
+  // the largest power-of-two number of buckets that fits into the requested size
+
+  const size_t nBytes = size_t(sizeMB)<<20;
+
+  size_t n=1;
+  while (2*n*sizeof(Bucket) <= nBytes)
+    n *= 2;
+
+  // if we cannot get that much memory, try with smaller tables
+
+  while (!allocate(n))
     {
-      mask <<= 1;
-      mask |= 1;
+      assert(n>1);
+      n /= 2;
     }
 
-  hits=collisions=misses=0;
+  mask = n-1;
 
   clear();
 }
 
+bool TranspositionTable::allocate(size_t n)
+{
+  const size_t lineSize = 64;
+
+#ifdef __linux__
+  // mmap'ed memory is page-aligned
+
+  memorySize = n*sizeof(Bucket);
+  void* mem = mmap(NULL, memorySize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    { return false; }
+
+#ifdef MADV_HUGEPAGE
+  // use huge pages (if available) to reduce the TLB misses of random table accesses
+  madvise(mem, memorySize, MADV_HUGEPAGE);
+#endif
+
+  memory = (char*)mem;
+  table  = (Bucket*)mem;
+#else
+  // align the buckets to cache-lines
+
+  memorySize = n*sizeof(Bucket) + lineSize-1;
+  memory = new (std::nothrow) char[memorySize];
+  if (memory == NULL)
+    { return false; }
+
+  table  = (Bucket*)(((size_t)memory + lineSize-1) & ~(lineSize-1));
+#endif
+
+  assert(((size_t)table & (lineSize-1)) == 0);
+
+  nBuckets = n;
+
+  for (size_t i=0;i<nBuckets;i++)
+    new (&table[i]) Bucket;
+
+  return true;
+}
+
+void TranspositionTable::release()
+{
+  if (memory==NULL)
+    return;
+
+  for (size_t i=0;i<nBuckets;i++)
+    table[i].~Bucket();
+
+#ifdef __linux__
+  munmap(memory, memorySize);
+#else
+  delete[] memory;
+#endif
+
+  memory=NULL;
+  table=NULL;
+  nBuckets=0;
+}
+
 void TranspositionTable::clear()
 {
-  for (int i=0;i<tableSize;i++)
-    {
-      table[i].hash = 0;
-    }
+  for (size_t i=0;i<nBuckets;i++)
+    for (int k=0;k<EntriesPerBucket;k++)
+      {
+	table[i].slot[k].keyMove = 0;
+	table[i].slot[k].data    = 0;
+      }
 }
 
-TranspositionTable::~TranspositionTable()
+void TranspositionTable::readSlot(const Slot& slot, Entry& e)
+{
+  const unsigned long long data    = slot.data;
+  const unsigned long long keyMove = slot.keyMove ^ dataCheck(data);
+
+  e.key      = (unsigned int)keyMove;
+  e.bestMove = PackedMove::fromBits((unsigned int)(keyMove>>32));
+  e.eval     = (short)(data & 0xFFFF);
+  e.depth    = (signed char)(((data>>16) & 0xFF) - 1);
+  e.bound    = (signed char)((data>>24) & 0xFF);
+  e.age      = (unsigned char)((data>>32) & 0xFF);
+}
+
+void TranspositionTable::writeSlot(Slot& slot, const Entry& e)
 {
-  delete[] table;
+  const unsigned long long data = ((unsigned long long)(unsigned short)(e.eval) |
+				   ((unsigned long long)(unsigned char)(e.depth+1) << 16) |
+				   ((unsigned long long)(unsigned char)(e.bound)   << 24) |
+				   ((unsigned long long)(e.age) << 32));
+  const unsigned long long keyMove = (unsigned long long)e.key | ((unsigned long long)e.bestMove.getBits() << 32);
+
+  slot.keyMove = keyMove ^ dataCheck(data);
+  slot.data    = data;
 }
 
-const TranspositionTable::Entry* TranspositionTable::lookup(BoardHash hash, const Board& b) const
+bool TranspositionTable::lookup(BoardHash hash, Entry& e, const Board& b) const
 {
-  BoardHash h = hash & mask;
+  const Bucket& bucket = table[hash & mask];
+  const unsigned int key = hashKey(hash);
 
   lookups++;
-  if (table[h].hash != 0) { hits++; }
-  if (table[h].hash != hash) { misses++; }
 
-#if SAFE_HASH
-  if (table[h].hash == hash && !(b==table[h].board))
+  for (int i=0;i<EntriesPerBucket;i++)
     {
-      std::cout << "HASH COLLISION\n";
-      assert(0);
-    }
+      readSlot(bucket.slot[i], e);
+
+      if (e.key == key && !e.isEmpty())
+	{
+#if SAFE_HASH
+	  if (!(b==bucket.slot[i].board))
+	    {
+	      std::cout << "HASH COLLISION\n";
+	      assert(0);
+	    }
 #endif
 
-  if (table[h].hash == hash)
-    {
-      return &table[h];
-    }
-  else
-    {
-      return NULL;
+	  hits++;
+	  return true;
+	}
     }
+
+  misses++;
+  return false;
 }
 
-void TranspositionTable::insert(BoardHash hash, float eval, BoundType bound, int depth, const Move& bestMove,
+void TranspositionTable::insert(BoardHash hash, int eval, BoundType bound, int depth, const Move& bestMove,
 				const Board& b)
 {
-  BoardHash h = hash & mask;
+  assert(eval >= -32768 && eval <= 32767);
 
-  bool replaceEntry = false;
-  /**/ if (table[h].hash==0)
-    {
-      replaceEntry=true;
-    }
-  else if (table[h].hash != hash) // collision
-    {
-      replaceEntry=true; /* Always replace such that irrelevant moves do not block the table. */
-      collisions++;
-    }
-  else
+  Bucket& bucket = table[hash & mask];
+  const unsigned int key = hashKey(hash);
+
+  Entry entry[EntriesPerBucket];
+  for (int i=0;i<EntriesPerBucket;i++)
+    readSlot(bucket.slot[i], entry[i]);
+
+  int replace = -1;
+
+  // if there is an entry for this board already, only replace it with a deeper result
+
+  for (int i=0;i<EntriesPerBucket;i++)
     {
-      if (depth > table[h].depth)
+      if (entry[i].key == key && !entry[i].isEmpty())
 	{
-	  replaceEntry=true;
+	  if (depth <= entry[i].depth && entry[i].age == age)
+	    return;
+
+	  replace = i;
+	  break;
 	}
-      else
+    }
+
+  /* Otherwise, use an empty entry or replace the least valuable one. Entries from
+     earlier searches count as shallower, such that the table does not fill up
+     with stale deep entries. */
+
+  if (replace<0)
+    {
+      int lowestValue=0;
+
+      for (int i=0;i<EntriesPerBucket;i++)
 	{
-	  /* NOP */
+	  if (entry[i].isEmpty())
+	    {
+	      replace = i;
+	      break;
+	    }
+
+	  const int value = entry[i].depth - 8*(unsigned char)(age - entry[i].age);
+	  if (replace<0 || value < lowestValue)
+	    {
+	      replace = i;
+	      lowestValue = value;
+	    }
 	}
+
+      if (!entry[replace].isEmpty()) { collisions++; }
     }
 
-  if (replaceEntry)
-    {
-      table[h].hash  = hash;
-      table[h].eval  = eval;
-      table[h].depth = depth;
-      table[h].bound = bound;
-      table[h].bestMove = bestMove;
+  Entry e;
+  e.key   = key;
+  e.eval  = eval;
+  e.depth = depth;
+  e.bound = bound;
+  e.age   = age;
+  e.bestMove = PackedMove(bestMove);
+
+  writeSlot(bucket.slot[replace], e);
 
 #if SAFE_HASH
-      table[h].board = b;
+  bucket.slot[replace].board = b;
 #endif
-    }
 }
 
 float TranspositionTable::getFillStatus() const
 {
-  int nFilled=0;
-  for (int i=0;i<tableSize;i++)
-    {
-      if (table[i].hash) { nFilled++; }
-    }
+  size_t nFilled=0;
+  for (size_t i=0;i<nBuckets;i++)
+    for (int k=0;k<EntriesPerBucket;k++)
+      {
+	Entry e;
+	readSlot(table[i].slot[k], e);
+	if (!e.isEmpty()) { nFilled++; }
+      }
 
-  return float(nFilled)/tableSize;
+  return float(nFilled)/(nBuckets*EntriesPerBucket);
 }
-
@@ -21,37 +21,61 @@
 
 #include "board.hh"
 
-#define SAFE_HASH 0
-
+#define SAFE_HASH 0  // store and compare the boards (requires switching off symmetric hashing)
+
+/* The transposition table is organized in buckets of 64 bytes (one cache-line),
+   each holding four compact entries. A board hash selects the bucket with its
+   lower bits, while the upper 32 bits are stored in the entry as the key.
+   When a bucket is full, the entry with the lowest depth is replaced, where
+   entries from earlier searches count as shallower. The age is increased by
+   calling newSearch() before each search.
+
+   The table size is given in megabytes and rounded down to a power of two.
+   On Linux, the table memory is requested to be backed by huge pages.
+
+   The table can be shared between several concurrently searching threads
+   without locking. Each entry is stored in two 64-bit words, where the first
+   word holds the key and move XOR-ed with a hash of the whole second word.
+   An entry that was read while another thread was writing it combines the
+   words of two writes and will (almost certainly) not verify, even if the two
+   writes only differ in the move or the age. It is treated like a miss.
+   The statistics counters are not synchronized and hence only approximate
+   when several threads use the table.
+ */
 class TranspositionTable
 {
 public:
-  TranspositionTable(int nBits);
+  TranspositionTable(int sizeMB);
   ~TranspositionTable();
 
+  /* Reallocate the table. This also clears the table. The table must not be
+     in use by any search while it is resized. */
+  void resize(int sizeMB);
+  int  getSize_MB() const { return sizeMB; }
+
   void clear();
+  void newSearch() { age++; }
 
   enum BoundType { LowerBound, AccurateValue, UpperBound };
 
   struct Entry
   {
-    BoardHash   hash;
-    float       eval;
-    signed char depth; // depth to which this node was calculated
-    signed char bound;
-    Move        bestMove;
-
-#if SAFE_HASH
-    Board board; // TMP
-#endif
+    unsigned int  key;   // upper 32 bits of the board hash
+    PackedMove    bestMove;
+    short         eval;  // integer evaluation of the search
+    signed char   depth; // depth to which this node was calculated, -1 for empty entries
+    signed char   bound;
+    unsigned char age;   // search in which this entry was last written
 
     BoundType getBoundType() const { return (BoundType)(bound); }
+    bool      isEmpty() const { return depth<0; }
   };
 
-  const Entry* lookup(BoardHash h, const Board&) const;
-  void insert(BoardHash h, float eval, BoundType, int depth, const Move& bestMove, const Board&);
+  /* Copy the entry for this hash into 'e'. Returns false if there is none. */
+  bool lookup(BoardHash h, Entry& e, const Board&) const;
+  void insert(BoardHash h, int eval, BoundType, int depth, const Move& bestMove, const Board&);
 
-  static inline BoundType boundType(float eval, float alpha, float beta)
+  static inline BoundType boundType(int eval, int alpha, int beta)
   {
     if (eval<=alpha) return UpperBound;
     if (eval>=beta)  return LowerBound;
@@ -66,9 +90,55 @@ public:
   float getFillStatus() const;
 
 private:
-  Entry* table;
-  int tableSize;
+  enum { EntriesPerBucket=4 };
+
+  /* The packed representation of an Entry in the table. All-zero is an empty slot.
+     keyMove: key (bits 0-31), bestMove (bits 32-63), XOR-ed with dataCheck(data)
+     data:    eval (bits 0-15), depth+1 (bits 16-23), bound (bits 24-31), age (bits 32-39)
+  */
+  struct Slot
+  {
+    volatile unsigned long long keyMove;
+    volatile unsigned long long data;
+
+#if SAFE_HASH
+    Board board; // TMP, not thread-safe
+#endif
+  };
+
+  struct Bucket
+  {
+    Slot slot[EntriesPerBucket];
+  };
+
+  char*   memory;  // unaligned allocation
+  size_t  memorySize;
+  Bucket* table;   // aligned to the cache-line size
+  size_t  nBuckets;
   BoardHash mask;
+  int     sizeMB;  // requested size
+
+  bool allocate(size_t nBuckets);
+  void release();
+
+  unsigned char age;
+
+  static unsigned int hashKey(BoardHash h) { return (unsigned int)(h>>32); }
+
+  /* Mixes all bits of the data word into all 64 bits, such that any change of 'data'
+     changes the key half (which is verified) of the decoded key/move word. */
+  static unsigned long long dataCheck(unsigned long long data)
+  {
+    data ^= data >> 33;
+    data *= 0xff51afd7ed558ccdULL;
+    data ^= data >> 33;
+    data *= 0xc4ceb9fe1a85ec53ULL;
+    data ^= data >> 33;
+    return data;
+  }
+
+  static void readSlot (const Slot&, Entry&); // decode the slot (which may be inconsistent)
+  static void writeSlot(Slot&, const Entry&);
 
   mutable int lookups,hits,collisions,misses;
 };
@@ -92,11 +162,12 @@ inline std::ostream& operator<<(std::ostream& ostr, const TranspositionTable::Bo
 
 inline std::ostream& operator<<(std::ostream& ostr, const TranspositionTable::Entry& e)
 {
-  ostr << "hash=" << std::hex << e.hash
+  ostr << "key=" << std::hex << e.key << std::dec
        << " eval=" << e.eval
        << " depth=" << ((int)e.depth)
        << " bound=" << e.getBoundType()
-       << " bestMove=" << e.bestMove;
+       << " age=" << ((int)e.age)
+       << " bestMove=" << e.bestMove.unpack();
   return ostr;
 }
 
@@ -74,6 +74,16 @@ public:
 typedef short Position;
 
 
+/* A set of board positions, stored as one bit per position.
+   MAXPOSITIONS must not exceed the number of bits.
+ */
+typedef unsigned long long PositionMask;
+
+inline PositionMask positionBit(Position p) { return PositionMask(1)<<p; }
+inline int      nPositionsInMask(PositionMask m) { return __builtin_popcountll(m); }
+inline Position firstPositionInMask(PositionMask m) { return __builtin_ctzll(m); } // undefined for m==0
+
+
 /* The player-identifier enum. */
 enum Player { PL_None=0, PL_Black=-1, PL_White=1 };
 